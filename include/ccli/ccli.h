@@ -26,28 +26,190 @@ SOFTWARE.
 
 #include <string>
 #include <array>
+#include <algorithm>
 #include <functional>
-#include <sstream>
+#include <charconv>
 #include <optional>
 #include <span>
 #include <map>
 #include <cstdint>
+#include <limits>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <future>
+#include <cstring>
+#include <memory_resource>
+#include <stdexcept>
 
 namespace ccli
 {
+	class VarBase;
+
 	// Parse
 	void parseArgs(size_t argc, const char* const argv[]);
+	// Splits the line into arguments like a shell (quotes and backslash escapes) and parses them like parseArgs,
+	// but '@file' arguments are not expanded
+	void parseLine(std::string_view line);
+	// Parses every line as a command of its own, lines starting with '#' are skipped
+	void parseLines(std::string_view script);
+	// Parses command lines repeatedly. Var lookups are cached and errors are collected into reused buffers, so once
+	// warmed up a parse without errors does no allocations and, unless the program name is detected, no syscalls.
+	class ParseContext
+	{
+	public:
+		// None: all arguments are options, Skip: argv[0] is the program name,
+		// Detect: argv[0] is skipped if it names an existing file (parseArgs)
+		enum class ProgramName { None, Skip, Detect };
+		struct Error
+		{
+			// File: a response file is missing or nested too deeply
+			enum class Kind { UnknownArg, MissingValue, Conversion, File };
+			Kind kind{ Kind::UnknownArg };
+			std::string argument;
+			// option which named the var of a Conversion error, e.g. '--level'. The var itself is not kept, a later
+			// callback may destroy it.
+			std::string option;
+			// line of parseLines, 0 otherwise
+			size_t line{ 0 };
+		};
+
+		explicit ParseContext(ProgramName programName = ProgramName::None);
+
+		// Applies all arguments, returns false if errors were collected
+		bool parse(size_t argc, const char* const argv[]);
+		bool parse(std::span<const std::string_view> args);
+		// Console input, '@file' tokens are not expanded
+		bool parseLine(std::string_view line);
+		bool parseLines(std::string_view script);
+		[[nodiscard]] std::span<const Error> errors() const noexcept { return { _errors.data(), _errorCount }; }
+		// Throws the first error of the last parse as the matching CCLIError
+		void throwFirstError() const;
+
+	private:
+		struct CachedVar
+		{
+			uint64_t hash{ 0 };
+			VarBase* var{ nullptr };
+			bool shortName{ false };
+		};
+
+		void begin();
+		bool finish();
+		void validateCache();
+		void addError(Error::Kind kind, std::string_view argument, std::string_view option = {});
+		VarBase* findVar(std::string_view name, bool shortName);
+		void setValue(VarBase& var, std::string_view option, std::string_view value);
+		void feed(std::string_view arg);
+		void valuelessVar();
+		[[nodiscard]] bool isWaitingForValue() const;
+		void feedArg(std::string_view arg, size_t depth);
+		void feedResponseFile(const std::string& path, size_t depth);
+
+		ProgramName _programName;
+		std::vector<Error> _errors;
+		size_t _errorCount{ 0 };
+		std::vector<CachedVar> _cache;
+		size_t _cachedCount{ 0 };
+		uint64_t _cacheGeneration{ 0 };
+		VarBase* _var{ nullptr };
+		size_t _idxOffset{ 0 };
+		size_t _line{ 0 };
+		std::string _option;
+		std::string _scratch;
+	};
+	// Applies environment variables starting with the prefix to the vars with the matching long name, ignoring case,
+	// '_' and '-' (APP_FOO_BAR sets fooBar). Variables matching several vars (fooBar and foo_bar) are reported as
+	// AmbiguousArgError. Errors are thrown once all values were applied, like in parseArgs.
+	void parseEnv(std::string_view prefix);
 	// Config
-	using ConfigCache = std::map<std::string, std::string>;
+	// Values by name. writeConfig only looks at vars changed after changeGeneration, so every cache keeps track of
+	// the changes it has seen on its own.
+	struct ConfigCache : std::map<std::string, std::string, std::less<>>
+	{
+		using std::map<std::string, std::string, std::less<>>::map;
+		uint64_t changeGeneration{ 0 };
+	};
 	ConfigCache loadConfig(const std::string& cfgFile);
+	// Same as loadConfig without building a cache
+	void applyConfig(const std::string& cfgFile);
+	// Same as applyConfig, but the values parsed by a previous run are copied from a binary cache next to the
+	// config (cfgFile + ".bin"). The text is parsed again and the cache rewritten if either of them changed.
+	void applyConfigCached(const std::string& cfgFile);
+	// Only looks at ConfigRdwr vars changed since the previous call with this cache and writes the file if the cache changed
 	void writeConfig(const std::string& cfgFile, ConfigCache& cache);
+	// Writes all ConfigRdwr vars
 	void writeConfig(const std::string& cfgFile);
+	// Merged values of several config files and the index of the file each value came from
+	struct LayeredConfig
+	{
+		std::vector<std::string> files;
+		ConfigCache cache;
+		std::map<std::string, size_t, std::less<>> origins;
+	};
+	// Parses the files in parallel, later files take precedence. Every var gets its final value once.
+	LayeredConfig loadConfigLayers(std::vector<std::string> cfgFiles);
+	// Same as writeConfig with a cache, but changed values are written to the file they came from. Values which
+	// are in none of the files are written to the last one.
+	void writeConfig(LayeredConfig& config);
+	// Same as writeConfig, but the values are written on a background thread. Requests for a file that was not
+	// written yet are merged. The future is ready once the file is written and rethrows write errors.
+	std::shared_future<void> writeConfigAsync(const std::string& cfgFile, ConfigCache& cache);
+	std::shared_future<void> writeConfigAsync(const std::string& cfgFile);
+	// Blocks until all asynchronous config writes have finished
+	void flushConfig();
+	// Applies values which changed in a config file. Changes are detected with inotify on Linux, elsewhere the
+	// modification time is compared on every poll. Pass the cache to writeConfig, so own writes are not applied again.
+	class ConfigWatcher
+	{
+	public:
+		ConfigWatcher(std::string cfgFile, ConfigCache cache);
+		~ConfigWatcher();
+
+		ConfigWatcher(const ConfigWatcher&) = delete;
+		ConfigWatcher& operator=(const ConfigWatcher&) = delete;
+
+		// Reloads the file if it changed and applies the values which differ from the cache, returns their number
+		size_t poll();
+		// Same as poll, without checking if the file changed
+		size_t reload();
+		[[nodiscard]] ConfigCache& cache() noexcept { return _cache; }
+		// File descriptor which becomes readable once the file changed, -1 if inotify is not used
+		[[nodiscard]] int nativeHandle() const noexcept { return _inotify; }
+
+	private:
+		[[nodiscard]] bool changed();
+
+		std::string _cfgFile;
+		ConfigCache _cache;
+		int _inotify{ -1 };
+		int _watch{ -1 };
+		uint64_t _size{ 0 };
+		int64_t _time{ 0 };
+	};
+	// Pool which holds the elements of Dynamic vars that do not fit into their inline buffer
+	[[nodiscard]] std::pmr::memory_resource* dynamicStorageResource() noexcept;
 	// Callback
 	void executeCallbacks();
 	// For all vars
-	class VarBase;
 	enum class IterationDecision { Continue, Break };
+	// Visits all registered vars in registration order. idx counts the visited vars, so it is the position
+	// of the var among the currently registered ones. Vars may be destroyed or unregistered by the callback.
 	IterationDecision forEachVar(const std::function<IterationDecision(VarBase& var, size_t idx)>&);
+	// Removes vars from the registry without destroying them, their names become available again
+	void unregisterVars(std::span<VarBase* const> vars);
+
+	struct MemoryStats
+	{
+		size_t varCount{ 0 };		// registered vars
+		size_t varBytes{ 0 };		// var objects, their std::function callbacks, pooled Dynamic elements and current Atomic copies
+		size_t nameCount{ 0 };		// distinct interned names and descriptions
+		size_t nameBytes{ 0 };		// characters of the interned strings
+		size_t nameArenaBytes{ 0 };	// blocks reserved for interned strings
+		size_t registryBytes{ 0 };	// name indices and the var list
+	};
+	// Footprint of the registered vars and the registry
+	[[nodiscard]] MemoryStats memoryStats();
 
 	enum Flag
 	{
@@ -72,15 +234,22 @@ namespace ccli
 		VarBase& operator=(const VarBase&) = delete;
 		VarBase& operator=(VarBase&&) = delete;
 
-		[[nodiscard]] const std::string& longName() const noexcept;
-		[[nodiscard]] const std::string& shortName() const noexcept;
-		[[nodiscard]] const std::string& description() const noexcept;
+		// Names and descriptions are interned, the views stay valid for the lifetime of the program
+		[[nodiscard]] std::string_view longName() const noexcept;
+		[[nodiscard]] std::string_view shortName() const noexcept;
+		[[nodiscard]] std::string_view description() const noexcept;
+		[[nodiscard]] bool isRegistered() const noexcept;
 
-		virtual std::string valueString() = 0;
+		// Writes the value as comma separated list into the buffer and returns the length of the full string.
+		// The output is truncated if the returned length exceeds the buffer size.
+		virtual size_t formatValue(std::span<char> buffer) const = 0;
+		[[nodiscard]] std::string valueString() const;
 		void valueString(std::string_view string);
 
-		virtual void chargeCallback() noexcept = 0;
+		// Marks the callback to be run by the next executeCallbacks call
+		void chargeCallback() noexcept;
 		[[nodiscard]] bool hasCallback() const noexcept;
+		[[nodiscard]] bool isCallbackCharged() const noexcept;
 		virtual bool executeCallback() = 0;
 
 		[[nodiscard]] virtual size_t size() const noexcept = 0;
@@ -96,6 +265,8 @@ namespace ccli
 		[[nodiscard]] virtual bool isIntegral() const = 0;
 		[[nodiscard]] virtual bool isFloatingPoint() const = 0;
 		[[nodiscard]] virtual bool isString() const = 0;
+		// The element count of Dynamic vars comes from the assigned value
+		[[nodiscard]] virtual bool isDynamic() const = 0;
 
 		[[nodiscard]] virtual std::optional<bool> asBool(size_t = 0) const = 0;
 		[[nodiscard]] virtual std::optional<long long> asInt(size_t = 0) const = 0;
@@ -112,23 +283,111 @@ namespace ccli
 		void locked(bool locked) noexcept;
 
         size_t setValueStringInternal(std::string_view, size_t offset = 0);
+
+		static constexpr size_t unregisteredSlot = SIZE_MAX;
 	protected:
 		static constexpr char _delimiter = ',';
 
-		virtual void setValueStringInternalAtIndex(size_t, std::string_view) = 0;
+		// Parses the comma separated elements starting at offset in one call, returns the index after the last one
+		virtual size_t setValueStringElements(std::string_view csv, size_t offset) = 0;
 		virtual void applyLimitsAndDoCallback() = 0;
-
-		static long long parseIntegral(const VarBase&, std::string_view);
+		// Runs the callback right away or charges it, depending on ManualExec
+		void doCallback();
+		// Moves ConfigRdwr vars to the end of the change list with a new change generation
+		void markConfigDirty();
+		// Applies a value loaded from a config before the var existed and adds the var to the registry. Called as the
+		// last step of the Var constructor, so other threads only ever find fully constructed vars.
+		// A config value which does not convert is dropped
+		void registerVar();
+		// Removes the var from the registry and the callback and change lists, then waits until no other thread
+		// uses it anymore. Called as the first step of the Var destructor, before the value is destroyed.
+		void unregisterForDestruction() noexcept;
+
+		// Numbers may have a sign and a 0x (hex) or 0b (binary) prefix, values outside of [min, max] are rejected
+		static long long parseIntegral(const VarBase&, std::string_view,
+			long long min = std::numeric_limits<long long>::min(), long long max = std::numeric_limits<long long>::max());
+		static unsigned long long parseUnsigned(const VarBase&, std::string_view,
+			unsigned long long max = std::numeric_limits<unsigned long long>::max());
 		static double parseDouble(const VarBase&, std::string_view);
-		static bool parseBool(std::string_view);
+		static float parseFloat(const VarBase&, std::string_view);
+		// Accepts true/false, 1/0, yes/no and on/off in any case, an empty token counts as true (valueless switch)
+		static bool parseBool(const VarBase&, std::string_view);
+		static std::optional<bool> tryParseBool(std::string_view) noexcept;
 
-		const std::string _shortName;
-		const std::string _longName;
-		const std::string _description;
+		// memchr is vectorized by the C library, which beats a byte loop on long arrays
+		[[nodiscard]] static const char* findDelimiter(const char* begin, const char* end) noexcept
+		{
+			if (begin == end) return end;
+			const void* found = std::memchr(begin, _delimiter, static_cast<size_t>(end - begin));
+			return found ? static_cast<const char*>(found) : end;
+		}
+
+		template <typename T>
+		static T parseNumber(const VarBase& var, const std::string_view token)
+		{
+			using Limits = std::numeric_limits<T>;
+			if constexpr (std::is_same_v<T, float>) return parseFloat(var, token);
+			else if constexpr (std::is_floating_point_v<T>) return static_cast<T>(parseDouble(var, token));
+			else if constexpr (std::is_signed_v<T>) return static_cast<T>(parseIntegral(var, token, Limits::min(), Limits::max()));
+			else return static_cast<T>(parseUnsigned(var, token, Limits::max()));
+		}
+
+		const std::string_view _shortName;
+		const std::string_view _longName;
+		const std::string_view _description;
 		uint32_t _flags;
 		const bool _hasCallback;
+		bool _callbackCharged{ false };
+		const uint64_t _shortNameHash;
+		const uint64_t _longNameHash;
+		size_t _registrySlot{ unregisteredSlot };
+
+	private:
+		friend void unregisterVars(std::span<VarBase* const>);
+		friend void executeCallbacks();
+		friend void writeConfig(const std::string&, ConfigCache&);
+		friend void writeConfig(LayeredConfig&);
+		friend std::shared_future<void> writeConfigAsync(const std::string&, ConfigCache&);
+		friend void applyConfigCached(const std::string&);
+		friend MemoryStats memoryStats();
+		friend class VarPin;
+		void unregister();
+		void queueCallback() noexcept;
+		void dequeueCallback() noexcept;
+		void unlinkCallback() noexcept;
+		void clearConfigDirty() noexcept;
+		void unlinkConfigChange() noexcept;
+		// registered vars changed after the generation, which is advanced to the latest change. Requires the registry lock.
+		static std::vector<VarBase*> configChangesSince(uint64_t& generation);
+
+		// bytes owned by the var, including memory it allocated
+		[[nodiscard]] virtual size_t memoryUsage() const noexcept = 0;
+
+		// binary config cache: element type and size, the first count elements of the config text as raw bytes.
+		// The text is parsed without touching the var, a ConversionError is thrown if it does not convert.
+		[[nodiscard]] virtual uint32_t binaryType() const noexcept = 0;
+		virtual void encodeBinaryValue(std::string& out, std::string_view csv, size_t count) const = 0;
+		// whether the data matches the var, loadBinaryValue only fails if this does
+		[[nodiscard]] virtual bool checkBinaryValue(std::string_view data, size_t count) const noexcept = 0;
+		// returns false if the data does not match the var, otherwise applies limits and callbacks like valueString
+		virtual bool loadBinaryValue(std::string_view data, size_t count) = 0;
+
+		// intrusive list of charged callbacks waiting for executeCallbacks
+		VarBase* _prevQueued{ nullptr };
+		VarBase* _nextQueued{ nullptr };
+		uint64_t _queueEpoch{ 0 };
+		bool _callbackQueued{ false };
+		// list of ConfigRdwr vars ordered by their last change, generation 0 if the var is not in the list
+		VarBase* _prevChanged{ nullptr };
+		VarBase* _nextChanged{ nullptr };
+		uint64_t _changeGeneration{ 0 };
+		// threads which use the var outside of the lock that found it, see VarPin
+		std::atomic<uint32_t> _pins{ 0 };
 	};
 
+	// Size of vars whose element count comes from the assigned value, e.g. Var<std::string, Dynamic> for a host list
+	inline constexpr size_t Dynamic = std::dynamic_extent;
+
 	template <typename TData, size_t S = 1>
 	struct Storage
 	{
@@ -166,6 +425,87 @@ namespace ccli
 		std::array<TData, 1> asArray() const noexcept { return { data }; }
 	};
 
+	// Short lists are kept in an inline buffer, longer ones are allocated from the memory resource
+	template <typename TData>
+	struct Storage<TData, Dynamic>
+	{
+		using TParameter = std::span<const TData>;
+		static constexpr size_t inlineCapacity = sizeof(TData) >= 64 ? 1 : 64 / sizeof(TData);
+
+		Storage(std::pmr::memory_resource* resource = dynamicStorageResource()) noexcept : _resource{ resource } {}
+		Storage(std::initializer_list<TData> values) : Storage() { assign({ values.begin(), values.size() }); }
+		Storage(std::span<const TData> values) : Storage() { assign(values); }
+		Storage(const Storage& other) : Storage(other._resource) { assign(other.view()); }
+		Storage& operator=(const Storage& other)
+		{
+			if (this != &other) assign(other.view());
+			return *this;
+		}
+		~Storage()
+		{
+			std::destroy_n(_data, _size);
+			if (_data != inlineData()) _resource->deallocate(_data, _capacity * sizeof(TData), alignof(TData));
+		}
+
+		[[nodiscard]] size_t size() const noexcept { return _size; }
+		[[nodiscard]] size_t capacity() const noexcept { return _capacity; }
+		auto& at(const size_t idx) { return _data[checkIndex(idx)]; }
+		const auto& at(const size_t idx) const { return _data[checkIndex(idx)]; }
+		TData* begin() noexcept { return _data; }
+		TData* end() noexcept { return _data + _size; }
+		const TData* begin() const noexcept { return _data; }
+		const TData* end() const noexcept { return _data + _size; }
+		[[nodiscard]] std::span<const TData> view() const noexcept { return { _data, _size }; }
+
+		void reserve(const size_t count)
+		{
+			if (count <= _capacity) return;
+			const size_t capacity = std::max(count, _capacity * 2);
+			auto* data = static_cast<TData*>(_resource->allocate(capacity * sizeof(TData), alignof(TData)));
+			std::uninitialized_move_n(_data, _size, data);
+			std::destroy_n(_data, _size);
+			if (_data != inlineData()) _resource->deallocate(_data, _capacity * sizeof(TData), alignof(TData));
+			_data = data;
+			_capacity = capacity;
+		}
+
+		// new elements are value initialized
+		void resize(const size_t count)
+		{
+			if (count < _size) std::destroy_n(_data + count, _size - count);
+			else
+			{
+				reserve(count);
+				std::uninitialized_value_construct_n(_data + _size, count - _size);
+			}
+			_size = count;
+		}
+
+		void assign(const std::span<const TData> values)
+		{
+			std::destroy_n(_data, _size);
+			_size = 0;
+			reserve(values.size());
+			std::uninitialized_copy_n(values.begin(), values.size(), _data);
+			_size = values.size();
+		}
+
+	private:
+		TData* inlineData() noexcept { return reinterpret_cast<TData*>(_inline); }
+
+		size_t checkIndex(const size_t idx) const
+		{
+			if (idx >= _size) throw std::out_of_range{ "ccli::Storage index out of range" };
+			return idx;
+		}
+
+		std::pmr::memory_resource* _resource;
+		TData* _data{ inlineData() };
+		size_t _size{ 0 };
+		size_t _capacity{ inlineCapacity };
+		alignas(TData) std::byte _inline[inlineCapacity * sizeof(TData)];
+	};
+
 	template <auto Value>
 	struct MaxLimit
 	{
@@ -180,6 +520,11 @@ namespace ccli
 		static T apply(T x) noexcept { return x < static_cast<T>(Value) ? static_cast<T>(Value) : x; }
 	};
 
+	// Policy which publishes values so they can be read from other threads while they are written. Scalars are stored
+	// in a std::atomic, other values are published as shared immutable copies which live as long as a reader holds
+	// them. There must only be one writer at a time.
+	struct Atomic {};
+
 	template <
 		typename TData,
 		size_t S = 1,
@@ -187,23 +532,70 @@ namespace ccli
 	>
 	class Var final : public VarBase
 	{
-		template <typename... TRest>
-		struct LimitApplier
+		template <typename T>
+		struct IsAlwaysLockFree : std::bool_constant<std::atomic<T>::is_always_lock_free> {};
+
+		static constexpr bool hasDynamicSize = S == Dynamic;
+		static constexpr bool isAtomic = (std::is_same_v<TLimits, Atomic> || ...);
+		static constexpr bool isAtomicScalar = isAtomic && S == 1
+			&& std::conjunction_v<std::is_arithmetic<TData>, IsAlwaysLockFree<TData>>;
+
+		static constexpr bool hasLimits = sizeof...(TLimits) > static_cast<size_t>(isAtomic);
+
+		// Atomic is a policy and passes values through unchanged
+		template <typename TLimit>
+		static TData applyLimit(const TData x) noexcept
 		{
-			static auto apply(Storage<TData, S> x)
+			if constexpr (std::is_same_v<TLimit, Atomic>) return x;
+			else return TLimit::apply(x);
+		}
+
+		// clamps every element by the whole chain of limits in a single loop, which the compiler can vectorize
+		static void applyLimits(Storage<TData, S>& x) noexcept
+		{
+			if constexpr (hasLimits)
 			{
-				return x;
+				for (auto& element : x) ((element = applyLimit<TLimits>(element)), ...);
 			}
+		}
+
+		// reader side copy of the value used by the Atomic policy
+		template <bool IsAtomic, bool IsScalar, typename = void>
+		struct Published
+		{
+			void publish(const Storage<TData, S>&) noexcept {}
+			[[nodiscard]] size_t memoryUsage() const noexcept { return 0; }
 		};
 
-		template <typename TLimit, typename... TRest>
-		struct LimitApplier<TLimit, TRest...>
+		template <typename Dummy>
+		struct Published<true, true, Dummy>
 		{
-			static auto apply(Storage<TData, S> x)
-			{
-				for(uint32_t i = 0; i < x.size(); i++) x.at(i) = TLimit::apply(x.at(i));
-				return LimitApplier<TRest...>::apply(x);
-			}
+			Storage<TData, S> load() const noexcept { return { value.load(std::memory_order_acquire) }; }
+			void publish(const Storage<TData, S>& x) noexcept { value.store(x.data, std::memory_order_release); }
+			[[nodiscard]] size_t memoryUsage() const noexcept { return 0; }
+			std::atomic<TData> value;
+		};
+
+		// readers only ever see immutable copies, a replaced copy is freed once the last reader released it
+		template <typename Dummy>
+		struct Published<true, false, Dummy>
+		{
+			using Snapshot = std::shared_ptr<const Storage<TData, S>>;
+
+			void publish(const Storage<TData, S>& x) { store(std::make_shared<const Storage<TData, S>>(x)); }
+			// only the current copy, replaced ones belong to the readers still holding them
+			[[nodiscard]] size_t memoryUsage() const noexcept { return sizeof(Storage<TData, S>) + heapBytes(*load()); }
+			// libstdc++ unlocks std::atomic<std::shared_ptr>::load with relaxed ordering, so the pointer read is not
+			// ordered before the next store. Its free functions take a mutex instead.
+#if defined(__cpp_lib_atomic_shared_ptr) && !defined(__GLIBCXX__)
+			Snapshot load() const noexcept { return current.load(std::memory_order_acquire); }
+			void store(Snapshot x) noexcept { current.store(std::move(x), std::memory_order_release); }
+			std::atomic<Snapshot> current;
+#else
+			Snapshot load() const noexcept { return std::atomic_load_explicit(&current, std::memory_order_acquire); }
+			void store(Snapshot x) noexcept { std::atomic_store_explicit(&current, std::move(x), std::memory_order_release); }
+			Snapshot current;
+#endif
 		};
 
 	public:
@@ -211,16 +603,23 @@ namespace ccli
 		using TCallback= std::function<void(typename TStorage::TParameter)>;
 		static_assert(std::disjunction_v<std::is_integral<TData>, std::is_floating_point<TData>, std::is_same<TData, std::string>>
 			, "Type must be integral, floating-point or string");
-		static_assert((!std::is_same_v<TData, std::string> && !std::is_same_v<TData, bool>) || sizeof...(TLimits) == 0,
+		static_assert((!std::is_same_v<TData, std::string> && !std::is_same_v<TData, bool>) || !hasLimits,
 			"String and boolean values may not have limits");
 
+		// Lightweight alternative to TCallback, the context is passed through unchanged
+		using TCallbackFn = void (*)(void* context, typename TStorage::TParameter);
+
 		Var(const std::string_view shortName, const std::string_view longName, const TStorage& value = {},
 		    const uint32_t flags = None, const std::string_view description = {},
-		    const TCallback callback = {})
-			: VarBase(shortName, longName, flags, description, static_cast<bool>(callback)),
-				_callback{ callback }, _callbackCharged{ false }, _value{ LimitApplier<TLimits...>::apply(value) } {}
+		    TCallback callback = {})
+			: Var(shortName, longName, value, flags, description, nullptr, nullptr,
+				callback ? std::make_unique<TCallback>(std::move(callback)) : nullptr) {}
+
+		Var(const std::string_view shortName, const std::string_view longName, const TStorage& value,
+		    const uint32_t flags, const std::string_view description, const TCallbackFn callback, void* const context)
+			: Var(shortName, longName, value, flags, description, callback, context, nullptr) {}
 
-		~Var() override = default;
+		~Var() override { unregisterForDestruction(); }
 		Var(const Var&) = delete;
 		Var(Var&&) = delete;
 		Var& operator=(const Var&) = delete;
@@ -232,51 +631,86 @@ namespace ccli
 			setValueInternal(value);
 		}
 
-		const auto& value() const noexcept { return _value.data; }
+		// Atomic scalars are returned by value, other Atomic values as std::shared_ptr to a copy which stays valid
+		// while it is held. Dynamic vars are returned as span, everything else by reference.
+		decltype(auto) value() const noexcept
+		{
+			if constexpr (isAtomicScalar) return readStorage()->data;
+			else if constexpr (isAtomic && hasDynamicSize) return readStorage();
+			else if constexpr (isAtomic)
+			{
+				auto snapshot = readStorage();
+				const auto* data = &snapshot->data;
+				return std::shared_ptr<const typename TStorage::TUnderlying>{ std::move(snapshot), data };
+			}
+			else if constexpr (hasDynamicSize) return _value.view();
+			else return (_value.data);
+		}
 
-		operator const TData&() const noexcept requires(S == 1) { return _value.data; }
-		operator const char* () const noexcept requires(S == 1 && std::is_same_v<TData, std::string>) { return _value.data.c_str(); }
-		const TData& operator[](size_t idx) const noexcept requires(S > 1) { return _value.data.at(idx); }
+		operator const TData&() const noexcept requires(S == 1 && !isAtomic) { return _value.data; }
+		// Atomic values are copied, the copy they were read from may be replaced right after
+		operator TData() const noexcept(isAtomicScalar) requires(S == 1 && isAtomic) { return readStorage()->data; }
+		operator const char* () const noexcept requires(S == 1 && std::is_same_v<TData, std::string> && !isAtomic) { return _value.data.c_str(); }
+		const TData& operator[](size_t idx) const requires(S > 1 && !isAtomic) { return _value.at(idx); }
+		TData operator[](size_t idx) const requires(S > 1 && isAtomic) { return readStorage()->at(idx); }
 
-		std::string valueString() override
+		size_t formatValue(const std::span<char> buffer) const override
 		{
-			std::basic_stringstream<char, std::char_traits<char>, std::allocator<char>> stream;
-			for (size_t i = 0; i != _value.size(); i++)
+			size_t length = 0;
+			auto append = [&](const std::string_view str) {
+				if (length < buffer.size()) str.copy(buffer.data() + length, buffer.size() - length);
+				length += str.size();
+			};
+
+			const auto storage = readStorage();
+			const auto& value = *storage;
+			for (size_t i = 0; i != value.size(); i++)
 			{
-				if (i) stream << _delimiter;
-				if constexpr (std::is_same_v<TData, std::string>) stream << _value.at(i);
-				else if constexpr (std::is_same_v<TData, bool>) stream << std::boolalpha << _value.at(i);
-				else stream << std::to_string(_value.at(i));
+				if (i) append({ &_delimiter, 1 });
+				const auto& element = value.at(i);
+				if constexpr (std::is_same_v<TData, std::string>) append(element);
+				else if constexpr (std::is_same_v<TData, bool>) append(element ? "true" : "false");
+				else
+				{
+					// floats use the shortest round-trip representation, character types are printed as numbers
+					char number[64];
+					std::to_chars_result result;
+					if constexpr (std::is_floating_point_v<TData>) result = std::to_chars(std::begin(number), std::end(number), element);
+					else if constexpr (std::is_signed_v<TData>) result = std::to_chars(std::begin(number), std::end(number), static_cast<long long>(element));
+					else result = std::to_chars(std::begin(number), std::end(number), static_cast<unsigned long long>(element));
+					append({ number, result.ptr });
+				}
 			}
-			return stream.str();
+			return length;
 		}
 
-		void chargeCallback() noexcept override { if(hasCallback()) _callbackCharged = true; }
 		bool executeCallback() override
 		{
 			if (hasCallback() && _callbackCharged)
 			{
-				_callback(_value.data);
+				const auto storage = readStorage();
+				if constexpr (hasDynamicSize) _callback.invoke(_callback.context, storage->view());
+				else _callback.invoke(_callback.context, storage->data);
 				_callbackCharged = false;
 				return true;
 			}
 			return false;
 		}
 
-		[[nodiscard]] size_t size() const noexcept override { return _value.size(); }
-		[[nodiscard]] bool isCallbackCharged() const noexcept { return _callbackCharged; }
+		[[nodiscard]] size_t size() const noexcept override { return readStorage()->size(); }
 
 		[[nodiscard]] bool isBool() const override { return std::is_same_v<TData, bool>; }
 		[[nodiscard]] bool isIntegral() const override { return not isBool() && std::is_integral_v<TData>; }
 		[[nodiscard]] bool isFloatingPoint() const override { return std::is_floating_point_v<TData>; }
 		[[nodiscard]] bool isString() const override { return std::is_same_v<TData, std::string>; }
+		[[nodiscard]] bool isDynamic() const override { return hasDynamicSize; }
 
 		template<typename T>
 		[[nodiscard]] std::optional<T> asNumeric(size_t idx = 0) const
 		{
 			if constexpr (not std::is_same_v<TData, std::string>)
 			{
-				return { static_cast<T>(_value.at(idx)) };
+				return { static_cast<T>(readStorage()->at(idx)) };
 			}
 			return {};
 		}
@@ -287,6 +721,7 @@ namespace ccli
 
 		[[nodiscard]] std::optional<std::string_view> asString(size_t idx = 0) const override
 		{
+			// a view of an Atomic string refers to the value of the writer, so it must only be taken by the writing thread
 			if constexpr (std::is_same_v<TData, std::string>)
 			{
 				return { std::string_view{ _value.at(idx) } };
@@ -298,7 +733,10 @@ namespace ccli
 		bool tryStoreNumeric(T val, size_t idx = 0) {
 			if constexpr (not std::is_same_v<TData, std::string>)
 			{
+				growTo(idx);
 				_value.at(idx) = static_cast<TData>(val);
+				_published.publish(_value);
+				markConfigDirty();
 				return true;
 			}
 			return false;
@@ -312,46 +750,208 @@ namespace ccli
 		{
 			if constexpr (std::is_same_v<TData, std::string>)
 			{
+				growTo(idx);
 				_value.at(idx) = std::move(val);
+				_published.publish(_value);
+				markConfigDirty();
 				return true;
 			}
 			return false;
 		}
 
 	private:
+		// std::function callbacks live on the heap, vars without one only carry the function pointer and context
+		struct CallbackRef
+		{
+			TCallbackFn invoke;
+			void* context;
+		};
+
+		Var(const std::string_view shortName, const std::string_view longName, const TStorage& value,
+		    const uint32_t flags, const std::string_view description, const TCallbackFn callback, void* const context,
+		    std::unique_ptr<TCallback> ownedCallback)
+			: VarBase(shortName, longName, flags, description, callback || ownedCallback),
+				_callback{ ownedCallback ? CallbackRef{ &invokeOwnedCallback, ownedCallback.get() } : CallbackRef{ callback, context } },
+				_ownedCallback{ std::move(ownedCallback) }, _value{ value }
+		{
+			applyLimits(_value);
+			_published.publish(_value);
+			registerVar();
+		}
+
+		static void invokeOwnedCallback(void* const callback, typename TStorage::TParameter value)
+		{
+			(*static_cast<const TCallback*>(callback))(value);
+		}
+
+		// writers work on _value, readers of Atomic vars only see the published copy. The result is used like a pointer
+		// and keeps the copy alive while it is read.
+		auto readStorage() const noexcept
+		{
+			if constexpr (isAtomicScalar) return std::optional<TStorage>{ _published.load() };
+			else if constexpr (isAtomic) return _published.load();
+			else return &_value;
+		}
+
+		// storing right behind the last element of a Dynamic var appends it
+		void growTo(const size_t idx)
+		{
+			if constexpr (hasDynamicSize)
+			{
+				if (idx == _value.size()) _value.resize(idx + 1);
+			}
+		}
+
 		void setValueInternal(const TStorage& value)
 		{
 			if (isReadOnly() || isLocked()) return;
 			_value = value;
-			if (hasCallback())
+			_published.publish(_value);
+			markConfigDirty();
+			doCallback();
+		}
+
+		static void parseElement(const VarBase& var, TData& element, const std::string_view token)
+		{
+			if constexpr (std::is_same_v<TData, bool>) element = parseBool(var, token);
+			else if constexpr (std::is_arithmetic_v<TData>) element = parseNumber<TData>(var, token);
+			else if constexpr (std::is_same_v<TData, std::string>) element = token;
+		}
+
+		size_t setValueStringElements(const std::string_view csv, const size_t offset) override
+		{
+			if constexpr (S == 1)
+			{
+				if (offset >= 1) return offset;
+				parseElement(*this, _value.data, csv.substr(0, static_cast<size_t>(findDelimiter(csv.data(), csv.data() + csv.size()) - csv.data())));
+				return 1;
+			}
+			else
+			{
+				// tokens beyond the size of the var are ignored, Dynamic vars end with the last token
+				size_t size = S;
+				if constexpr (hasDynamicSize)
+				{
+					size = offset + (csv.empty() ? 0 : static_cast<size_t>(std::count(csv.begin(), csv.end(), _delimiter)) + 1);
+					_value.resize(size);
+				}
+				TData* const elements = std::to_address(_value.begin());
+				const char* current = csv.data();
+				const char* const end = current + csv.size();
+				size_t idx = offset;
+				while (idx < size)
+				{
+					const char* const delimiter = findDelimiter(current, end);
+					parseElement(*this, elements[idx++], { current, static_cast<size_t>(delimiter - current) });
+					if (delimiter == end) break;
+					current = delimiter + 1;
+				}
+				return idx;
+			}
+		}
+
+		[[nodiscard]] uint32_t binaryType() const noexcept override
+		{
+			// kind in the upper bits, element size in the lower bits
+			if constexpr (std::is_same_v<TData, std::string>) return 5u << 8;
+			else if constexpr (std::is_same_v<TData, bool>) return 1u << 8 | sizeof(TData);
+			else if constexpr (std::is_floating_point_v<TData>) return 4u << 8 | sizeof(TData);
+			else if constexpr (std::is_signed_v<TData>) return 2u << 8 | sizeof(TData);
+			else return 3u << 8 | sizeof(TData);
+		}
+
+		void encodeBinaryValue(std::string& out, const std::string_view csv, const size_t count) const override
+		{
+			const char* current = csv.data();
+			const char* const end = current + csv.size();
+			for (size_t i = 0; i < count; i++)
+			{
+				const char* const delimiter = findDelimiter(current, end);
+				TData element{};
+				parseElement(*this, element, { current, static_cast<size_t>(delimiter - current) });
+				if constexpr (std::is_same_v<TData, std::string>)
+				{
+					const auto length = static_cast<uint32_t>(element.size());
+					out.append(reinterpret_cast<const char*>(&length), sizeof(length));
+					out += element;
+				}
+				else out.append(reinterpret_cast<const char*>(&element), sizeof(element));
+				if (delimiter == end) break;
+				current = delimiter + 1;
+			}
+		}
+
+		[[nodiscard]] bool checkBinaryValue(std::string_view data, const size_t count) const noexcept override
+		{
+			if (count > _value.size() && !hasDynamicSize) return false;
+			if constexpr (std::is_same_v<TData, std::string>)
 			{
-				_callbackCharged = true;
-				if (isCallbackAutoExecuted()) executeCallback();
+				for (size_t i = 0; i < count; i++)
+				{
+					uint32_t length;
+					if (data.size() < sizeof(length)) return false;
+					std::memcpy(&length, data.data(), sizeof(length));
+					if (data.size() - sizeof(length) < length) return false;
+					data.remove_prefix(sizeof(length) + length);
+				}
+				return data.empty();
 			}
+			else return data.size() == count * sizeof(TData);
 		}
 
-		void setValueStringInternalAtIndex(size_t idx, std::string_view token) override {
-			if (idx >= _value.size()) return;
+		bool loadBinaryValue(std::string_view data, const size_t count) override
+		{
+			// nothing is assigned unless the whole value fits
+			if (!checkBinaryValue(data, count)) return false;
+			// same rules as valueString, config files cannot change these vars
+			if (isReadOnly() || isCliOnly() || isLocked()) return true;
+			if constexpr (hasDynamicSize) _value.resize(count);
 
-			if constexpr (std::is_floating_point_v<TData>) _value.at(idx) = static_cast<TData>(parseDouble(*this, token));
-			else if constexpr (std::is_same_v<TData, bool>) _value.at(idx) = parseBool(token);
-			else if constexpr (std::is_integral_v<TData>) _value.at(idx) = static_cast<TData>(parseIntegral(*this, token));
-			else if constexpr (std::is_same_v<TData, std::string>) _value.at(idx) = token;
+			if constexpr (std::is_same_v<TData, std::string>)
+			{
+				for (size_t i = 0; i < count; i++)
+				{
+					uint32_t length;
+					std::memcpy(&length, data.data(), sizeof(length));
+					_value.at(i).assign(data.data() + sizeof(length), length);
+					data.remove_prefix(sizeof(length) + length);
+				}
+			}
+			else
+			{
+				if constexpr (S == 1) std::memcpy(&_value.data, data.data(), data.size());
+				else if (count) std::memcpy(std::to_address(_value.begin()), data.data(), data.size());
+			}
+			applyLimitsAndDoCallback();
+			return true;
 		}
 
 		void applyLimitsAndDoCallback() override {
-			if constexpr (!std::is_same_v<TData, std::string>)
+			applyLimits(_value);
+			_published.publish(_value);
+			markConfigDirty();
+			doCallback();
+		}
+
+		// elements of Dynamic vars which do not fit into the inline buffer
+		static size_t heapBytes(const TStorage& value) noexcept
+		{
+			if constexpr (hasDynamicSize)
 			{
-				_value = LimitApplier<TLimits...>::apply(_value);
+				if (value.capacity() > TStorage::inlineCapacity) return value.capacity() * sizeof(TData);
 			}
+			return 0;
+		}
 
-			_callbackCharged = true;
-			if (isCallbackAutoExecuted()) executeCallback();
+		[[nodiscard]] size_t memoryUsage() const noexcept override
+		{
+			return sizeof(*this) + (_ownedCallback ? sizeof(TCallback) : 0) + heapBytes(_value) + _published.memoryUsage();
 		}
 
-		const TCallback _callback;
-		bool _callbackCharged;
+		const CallbackRef _callback;
+		const std::unique_ptr<TCallback> _ownedCallback;
 		TStorage _value;
+		Published<isAtomic, isAtomicScalar> _published;
 	};
 
 	class CCLIError : public std::exception {
@@ -377,10 +977,15 @@ namespace ccli
 
 	class FileError final : public CCLIError {
 	public:
-		explicit FileError(std::string path);
+		// Write: a config file could not be written, ResponseFile: an '@file' argument could not be read
+		enum class Kind { Write, ResponseFile };
+		explicit FileError(std::string path, Kind kind = Kind::Write);
 		std::string_view message() const override;
 		void throwSelf() const override;
 		std::string_view filePath() const { return _arg; }
+		Kind kind() const { return _kind; }
+	private:
+		Kind _kind;
 	};
 
 	class UnknownArgError final : public CCLIError {
@@ -391,6 +996,15 @@ namespace ccli
 		std::string_view unknownName() const { return _arg; }
 	};
 
+	// an environment variable whose name normalizes to the long names of several vars
+	class AmbiguousArgError final : public CCLIError {
+	public:
+		explicit AmbiguousArgError(std::string name);
+		std::string_view message() const override;
+		void throwSelf() const override;
+		std::string_view ambiguousName() const { return _arg; }
+	};
+
 	class MissingValueError final : public CCLIError {
 	public:
 		explicit MissingValueError(std::string name);
@@ -25,412 +25,2518 @@ SOFTWARE.
 #include <ccli/ccli.h>
 
 #include <cassert>
+#include <charconv>
 #include <map>
-#include <set>
+#include <unordered_map>
+#include <deque>
 #include <fstream>
+#include <sstream>
 #include <filesystem>
 #include <algorithm>
 #include <variant>
+#include <optional>
+#include <mutex>
+#include <shared_mutex>
+#include <condition_variable>
+#include <thread>
+#include <future>
+#include <cstring>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <climits>
+#endif
+#include <sys/stat.h>
+#include <unistd.h>
+extern char** environ;
+#endif
+
+namespace ccli
+{
+	// Keeps a var alive while it is used outside of the lock which found it, the var destructor unregisters the
+	// var and then waits until it is no longer pinned. Must be created while the var cannot be destroyed yet, e.g.
+	// under the registry lock. Pins of one thread are released in reverse order.
+	class VarPin
+	{
+	public:
+		explicit VarPin(VarBase& var) : _index{ pinnedVars().size() }
+		{
+			pinnedVars().push_back(&var);
+			var._pins.fetch_add(1, std::memory_order_relaxed);
+		}
+		~VarPin()
+		{
+			auto& pinned = pinnedVars();
+			if (pinned[_index]) pinned[_index]->_pins.fetch_sub(1, std::memory_order_release);
+			pinned.pop_back();
+		}
+		VarPin(const VarPin&) = delete;
+		VarPin& operator=(const VarPin&) = delete;
+
+		// a thread may destroy a var it pinned itself, e.g. from a forEachVar callback, it does not wait for itself
+		static void releaseOwn(VarBase& var) noexcept
+		{
+			for (VarBase*& pinned : pinnedVars())
+			{
+				if (pinned != &var) continue;
+				pinned = nullptr;
+				var._pins.fetch_sub(1, std::memory_order_relaxed);
+			}
+		}
+
+	private:
+		static std::vector<VarBase*>& pinnedVars() noexcept
+		{
+			thread_local std::vector<VarBase*> vars;
+			return vars;
+		}
+
+		size_t _index;
+	};
+}
 
 namespace
 {
 	using namespace std::literals;
 
 	constexpr char configDelimiter = '=';
-	using MapType = std::map<std::string, ccli::VarBase*, std::less<>>;
 	using VecType = std::vector<ccli::VarBase*>;
 
+	/*
+	** hashing
+	*/
+	// 64 bit FNV-1a with a final avalanche step, so the low bits can be used for probing
+	constexpr uint64_t hashName(const std::string_view name) noexcept
+	{
+		uint64_t hash = 0xcbf29ce484222325ull;
+		for (const char c : name)
+		{
+			hash ^= static_cast<unsigned char>(c);
+			hash *= 0x100000001b3ull;
+		}
+		hash ^= hash >> 32;
+		hash *= 0xd6e8feb86659fd93ull;
+		hash ^= hash >> 32;
+		return hash;
+	}
+
+	/*
+	** index
+	*/
+	// open addressing hash index (linear probing, backward shift deletion) mapping names to vars
+	class VarIndex {
+	public:
+		[[nodiscard]] ccli::VarBase* find(const std::string_view name, const uint64_t hash) const noexcept
+		{
+			if (_slots.empty()) return nullptr;
+			for (size_t i = hash & mask();; i = (i + 1) & mask())
+			{
+				const Slot& slot = _slots[i];
+				if (!slot.var) return nullptr;
+				if (slot.hash == hash && slot.name == name) return slot.var;
+			}
+		}
+
+		// returns false if the name is already taken
+		bool insert(const std::string_view name, const uint64_t hash, ccli::VarBase* const var)
+		{
+			if ((_count + 1) * 4 > _slots.size() * 3) grow();
+			size_t i = hash & mask();
+			for (; _slots[i].var; i = (i + 1) & mask())
+			{
+				if (_slots[i].hash == hash && _slots[i].name == name) return false;
+			}
+			_slots[i] = { hash, name, var };
+			_count++;
+			return true;
+		}
+
+		void erase(const std::string_view name, const uint64_t hash, const ccli::VarBase* const var) noexcept
+		{
+			if (_slots.empty()) return;
+			size_t i = hash & mask();
+			for (;; i = (i + 1) & mask())
+			{
+				if (!_slots[i].var) return;
+				if (_slots[i].hash == hash && _slots[i].name == name) break;
+			}
+			if (_slots[i].var != var) return;
+
+			// shift following entries of the probe sequence back into the hole
+			for (size_t j = (i + 1) & mask();; j = (j + 1) & mask())
+			{
+				if (!_slots[j].var) break;
+				const size_t home = _slots[j].hash & mask();
+				if (((j - home) & mask()) >= ((j - i) & mask()))
+				{
+					_slots[i] = _slots[j];
+					i = j;
+				}
+			}
+			_slots[i] = {};
+			_count--;
+		}
+
+		[[nodiscard]] size_t size() const noexcept { return _count; }
+		[[nodiscard]] size_t memoryUsage() const noexcept { return _slots.capacity() * sizeof(Slot); }
+
+	private:
+		struct Slot
+		{
+			uint64_t hash{ 0 };
+			std::string_view name;
+			ccli::VarBase* var{ nullptr };
+		};
+
+		[[nodiscard]] size_t mask() const noexcept { return _slots.size() - 1; }
+
+		void grow()
+		{
+			std::vector<Slot> old(_slots.empty() ? 16 : _slots.size() * 2);
+			old.swap(_slots);
+			for (const Slot& slot : old)
+			{
+				if (!slot.var) continue;
+				size_t i = slot.hash & mask();
+				while (_slots[i].var) i = (i + 1) & mask();
+				_slots[i] = slot;
+			}
+		}
+
+		std::vector<Slot> _slots;
+		size_t _count{ 0 };
+	};
+
+	/*
+	** locking
+	*/
+#ifdef CCLI_THREAD_SAFE
+	using RegistryMutex = std::shared_mutex;
+	using CallbackMutex = std::mutex;
+#else
+	// no-op locks if the registry is only used from a single thread
+	struct RegistryMutex
+	{
+		void lock() noexcept {}
+		void unlock() noexcept {}
+		void lock_shared() noexcept {}
+		void unlock_shared() noexcept {}
+	};
+	using CallbackMutex = RegistryMutex;
+#endif
+
+	// guards the var indices and the var list, lookups only take a shared lock
+	RegistryMutex& getRegistryMutex()
+	{
+		static RegistryMutex mutex;
+		return mutex;
+	}
+
+	// guards the callback queue
+	CallbackMutex& getCallbackMutex()
+	{
+		static CallbackMutex mutex;
+		return mutex;
+	}
+
+	// guards the config change list
+	CallbackMutex& getDirtyMutex()
+	{
+		static CallbackMutex mutex;
+		return mutex;
+	}
+
+	/*
+	** names
+	*/
+	// Interns var names and descriptions into shared blocks, equal strings are stored once. Blocks are never freed,
+	// so the views handed out stay valid even after the var is gone and its name is reused.
+	class NameArena {
+	public:
+		[[nodiscard]] std::string_view intern(const std::string_view str)
+		{
+			if (str.empty()) return {};
+			if ((_count + 1) * 4 > _slots.size() * 3) grow();
+
+			const auto hash = static_cast<uint32_t>(hashName(str));
+			size_t i = hash & mask();
+			for (; _slots[i].data; i = (i + 1) & mask())
+			{
+				if (_slots[i].hash == hash && _slots[i].view() == str) return _slots[i].view();
+			}
+			const std::string_view stored = store(str);
+			_slots[i] = { hash, static_cast<uint32_t>(stored.size()), stored.data() };
+			_count++;
+			_stringBytes += str.size();
+			return stored;
+		}
+
+		[[nodiscard]] size_t count() const noexcept { return _count; }
+		[[nodiscard]] size_t stringBytes() const noexcept { return _stringBytes; }
+		[[nodiscard]] size_t reservedBytes() const noexcept { return _reservedBytes + _slots.capacity() * sizeof(Slot); }
+
+	private:
+		static constexpr size_t blockSize = 64 * 1024;
+
+		// 16 bytes per slot, names are assumed to be shorter than 4 GiB
+		struct Slot
+		{
+			uint32_t hash{ 0 };
+			uint32_t size{ 0 };
+			const char* data{ nullptr };
+
+			[[nodiscard]] std::string_view view() const noexcept { return { data, size }; }
+		};
+
+		[[nodiscard]] size_t mask() const noexcept { return _slots.size() - 1; }
+
+		void grow()
+		{
+			std::vector<Slot> old(_slots.empty() ? 64 : _slots.size() * 2);
+			old.swap(_slots);
+			for (const Slot& slot : old)
+			{
+				if (!slot.data) continue;
+				size_t i = slot.hash & mask();
+				while (_slots[i].data) i = (i + 1) & mask();
+				_slots[i] = slot;
+			}
+		}
+
+		// long strings get a block of their own, so the current block is not abandoned
+		std::string_view store(const std::string_view str)
+		{
+			char* target;
+			if (str.size() > blockSize / 4)
+			{
+				target = _blocks.emplace_back(std::make_unique<char[]>(str.size())).get();
+				_reservedBytes += str.size();
+			}
+			else
+			{
+				if (_free < str.size())
+				{
+					_current = _blocks.emplace_back(std::make_unique<char[]>(blockSize)).get();
+					_free = blockSize;
+					_reservedBytes += blockSize;
+				}
+				target = _current;
+				_current += str.size();
+				_free -= str.size();
+			}
+			str.copy(target, str.size());
+			return { target, str.size() };
+		}
+
+		std::vector<Slot> _slots;
+		size_t _count{ 0 };
+		std::vector<std::unique_ptr<char[]>> _blocks;
+		char* _current{ nullptr };
+		size_t _free{ 0 };
+		size_t _reservedBytes{ 0 };
+		size_t _stringBytes{ 0 };
+	};
+
+	NameArena& getNameArena()
+	{
+		static NameArena arena;
+		return arena;
+	}
+
+	// guards the name arena
+	CallbackMutex& getNameArenaMutex()
+	{
+		static CallbackMutex mutex;
+		return mutex;
+	}
+
+	std::string_view internName(const std::string_view name)
+	{
+		std::lock_guard lock{ getNameArenaMutex() };
+		return getNameArena().intern(name);
+	}
+
 	/*
 	** vars
 	*/
 	// contains static lists keeping track of all vars
-	MapType& getLongNameVarMap()
+	VarIndex& getLongNameVarMap()
 	{
-		static MapType map;
+		static VarIndex map;
 		return map;
 	}
 
-	MapType& getShortNameVarMap()
+	VarIndex& getShortNameVarMap()
 	{
-		static MapType map;
+		static VarIndex map;
 		return map;
 	}
 
-	VecType& getVarList() {
-		static VecType map;
-		return map;
+	// registration ordered list, removed vars leave a tombstone (nullptr) until the list is compacted
+	struct VarListEntry
+	{
+		ccli::VarBase* var;
+		size_t* slot;
+	};
+
+	struct VarList
+	{
+		std::vector<VarListEntry> entries;
+		size_t tombstones{ 0 };
+		size_t iterating{ 0 };
+	};
+
+	VarList& getVarList() {
+		static VarList list;
+		return list;
+	}
+
+	// drop tombstones once they make up half of the list, slots of the remaining vars are rewritten
+	// requires the registry lock
+	void compactVarList()
+	{
+		auto& list = getVarList();
+		if (list.iterating || list.tombstones * 2 < list.entries.size()) return;
+
+		size_t dst = 0;
+		for (const VarListEntry& entry : list.entries)
+		{
+			if (!entry.var) continue;
+			*entry.slot = dst;
+			list.entries[dst++] = entry;
+		}
+		list.entries.resize(dst);
+		list.tombstones = 0;
 	}
 
 	ccli::VarBase* findVarByLongName(const std::string_view longName)
 	{
-		MapType& map = getLongNameVarMap();
-		const auto it = map.find(longName);
-		if (it != map.end()) return it->second;
-		return nullptr;
+		const uint64_t hash = hashName(longName);
+		std::shared_lock lock{ getRegistryMutex() };
+		return getLongNameVarMap().find(longName, hash);
 	}
 
 	ccli::VarBase* findVarByShortName(const std::string_view shortName)
 	{
-		auto& map = getShortNameVarMap();
-		const auto it = map.find(shortName);
-		if (it != map.end()) return it->second;
-		return nullptr;
+		const uint64_t hash = hashName(shortName);
+		std::shared_lock lock{ getRegistryMutex() };
+		return getShortNameVarMap().find(shortName, hash);
+	}
+
+	// requires the registry lock
+	void addToVarList(const std::string_view longName, const uint64_t longNameHash,
+		const std::string_view shortName, const uint64_t shortNameHash, ccli::VarBase* const aVar, size_t& slot)
+	{
+		auto& mapLong = getLongNameVarMap();
+		auto& mapShort = getShortNameVarMap();
+
+		if (!shortName.empty() && !mapShort.insert(shortName, shortNameHash, aVar))
+		{
+			throw ccli::DuplicatedVarNameError{ std::string{ shortName } };
+		}
+
+		if (!longName.empty() && !mapLong.insert(longName, longNameHash, aVar))
+		{
+			if (!shortName.empty()) mapShort.erase(shortName, shortNameHash, aVar);
+			throw ccli::DuplicatedVarNameError{ std::string{ longName } };
+		}
+
+		auto& list = getVarList();
+		slot = list.entries.size();
+		list.entries.push_back({ aVar, &slot });
+	}
+
+	// changes whenever a var is unregistered, so cached var pointers can be validated without the registry lock
+	std::atomic<uint64_t>& getRegistryGeneration()
+	{
+		static std::atomic<uint64_t> generation{ 0 };
+		return generation;
+	}
+
+	// requires the registry lock, compaction is left to the caller so bulk removals only compact once
+	void removeFromVarList(const std::string_view longName, const uint64_t longNameHash,
+		const std::string_view shortName, const uint64_t shortNameHash, const ccli::VarBase* const aVar, size_t& slot)
+	{
+		if (slot == ccli::VarBase::unregisteredSlot) return;
+		getRegistryGeneration().fetch_add(1, std::memory_order_acq_rel);
+
+		if (!longName.empty()) getLongNameVarMap().erase(longName, longNameHash, aVar);
+		if (!shortName.empty()) getShortNameVarMap().erase(shortName, shortNameHash, aVar);
+
+		auto& list = getVarList();
+		assert(slot < list.entries.size() && list.entries[slot].var == aVar);
+		list.entries[slot].var = nullptr;
+		list.tombstones++;
+		slot = ccli::VarBase::unregisteredSlot;
+	}
+
+	/*
+	** callbacks
+	*/
+	// fifo of vars with charged callbacks, each var is queued at most once
+	struct CallbackQueue
+	{
+		ccli::VarBase* head{ nullptr };
+		ccli::VarBase* tail{ nullptr };
+		uint64_t epoch{ 0 };
+	};
+
+	CallbackQueue& getCallbackQueue()
+	{
+		static CallbackQueue queue;
+		return queue;
+	}
+
+	/*
+	** config
+	*/
+	// ConfigRdwr vars ordered by their last change, each var is listed once. Every change gets a new generation,
+	// so a cache only has to walk back from the tail until it reaches the changes it has already seen.
+	struct ConfigChangeList
+	{
+		ccli::VarBase* head{ nullptr };
+		ccli::VarBase* tail{ nullptr };
+		uint64_t generation{ 0 };
+	};
+
+	ConfigChangeList& getConfigChangeList()
+	{
+		static ConfigChangeList list;
+		return list;
+	}
+
+	struct NameHash
+	{
+		using is_transparent = void;
+		size_t operator()(const std::string_view name) const noexcept { return static_cast<size_t>(hashName(name)); }
+	};
+
+	// config values without a var, applied once by the constructor of a var registered later
+	struct PendingConfig
+	{
+		std::unordered_map<std::string, std::string, NameHash, std::equal_to<>> values;
+		// lets vars skip the lock while nothing is pending
+		std::atomic<size_t> count{ 0 };
+	};
+
+	PendingConfig& getPendingConfig()
+	{
+		static PendingConfig pending;
+		return pending;
+	}
+
+	CallbackMutex& getPendingConfigMutex()
+	{
+		static CallbackMutex mutex;
+		return mutex;
+	}
+
+	// removes and returns the value pending for the name, if any
+	std::optional<std::string> takePendingConfig(const std::string_view name)
+	{
+		auto& pending = getPendingConfig();
+		if (!pending.count.load(std::memory_order_acquire)) return std::nullopt;
+
+		std::unique_lock lock{ getPendingConfigMutex() };
+		const auto it = pending.values.find(name);
+		if (it == pending.values.end()) return std::nullopt;
+		std::string value = std::move(it->second);
+		pending.values.erase(it);
+		pending.count.store(pending.values.size(), std::memory_order_release);
+		return value;
+	}
+
+	// formats the value into the reused buffer, only allocates if the buffer is too small
+	std::string_view formatValue(const ccli::VarBase& var, std::string& buffer)
+	{
+		buffer.resize(buffer.capacity());
+		const size_t length = var.formatValue(buffer);
+		if (length > buffer.size())
+		{
+			buffer.resize(length);
+			var.formatValue(buffer);
+		}
+		return { buffer.data(), length };
+	}
+
+	// returns the updated cache entry, or nullptr if the value did not change
+	const ccli::ConfigCache::value_type* updateConfigCache(ccli::ConfigCache& cache, const std::string_view token, const std::string_view value)
+	{
+		const auto it = cache.find(token);
+		if (it != cache.end() && it->second != value)
+		{
+			it->second = value;
+			return &*it;
+		}
+		if (it == cache.end())
+		{
+			return &*cache.emplace_hint(it, token, value);
+		}
+		return nullptr;
+	}
+
+	/*
+	** files
+	*/
+	// read only memory mapping of a whole file, a missing or empty file results in an empty view
+	class MappedFile {
+	public:
+		explicit MappedFile(const std::string& path)
+		{
+#ifdef _WIN32
+			_file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+			if (_file == INVALID_HANDLE_VALUE) return;
+			LARGE_INTEGER size;
+			if (!GetFileSizeEx(_file, &size) || size.QuadPart == 0) return;
+			_mapping = CreateFileMappingA(_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+			if (!_mapping) return;
+			_data = static_cast<const char*>(MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0));
+			if (_data) _size = static_cast<size_t>(size.QuadPart);
+#else
+			_fd = open(path.c_str(), O_RDONLY);
+			if (_fd < 0) return;
+			struct stat info{};
+			if (fstat(_fd, &info) != 0 || info.st_size <= 0) return;
+			void* data = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, _fd, 0);
+			if (data == MAP_FAILED) return;
+			_data = static_cast<const char*>(data);
+			_size = static_cast<size_t>(info.st_size);
+#endif
+		}
+
+		~MappedFile()
+		{
+#ifdef _WIN32
+			if (_data) UnmapViewOfFile(_data);
+			if (_mapping) CloseHandle(_mapping);
+			if (_file != INVALID_HANDLE_VALUE) CloseHandle(_file);
+#else
+			if (_data) munmap(const_cast<char*>(_data), _size);
+			if (_fd >= 0) close(_fd);
+#endif
+		}
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		[[nodiscard]] std::string_view view() const noexcept { return { _data, _size }; }
+
+	private:
+		const char* _data{ nullptr };
+		size_t _size{ 0 };
+#ifdef _WIN32
+		HANDLE _file{ INVALID_HANDLE_VALUE };
+		HANDLE _mapping{ nullptr };
+#else
+		int _fd{ -1 };
+#endif
+	};
+
+	bool hasQuote(const std::string_view str) noexcept
+	{
+		return std::memchr(str.data(), '\"', str.size()) || std::memchr(str.data(), '\'', str.size());
+	}
+
+	struct ConfigEntry
+	{
+		std::string_view token;
+		std::string_view value;
+		size_t lineOffset;
+		size_t lineLength;		// including the line break
+		size_t valueOffset;		// npos if the value is not stored verbatim in the content
+	};
+
+	// Calls f(entry) for every 'token=value' line, all quotation marks are removed except for \" inside a double
+	// quoted value, which stands for a quote. The common 'token="value"'
+	// form is passed on as views into the content, only lines with other quotes are copied into a scratch buffer.
+	template <typename F>
+	void scanConfig(const std::string_view content, F&& f)
+	{
+		std::string scratch;
+		const char* current = content.data();
+		const char* const end = content.data() + content.size();
+		while (current < end)
+		{
+			const char* newline = static_cast<const char*>(std::memchr(current, '\n', static_cast<size_t>(end - current)));
+			const char* lineEnd = newline ? newline : end;
+			std::string_view line{ current, static_cast<size_t>(lineEnd - current) };
+			const size_t lineOffset = static_cast<size_t>(current - content.data());
+			const size_t lineLength = line.size() + (newline ? 1 : 0);
+			current = lineEnd + 1;
+
+			const char* delimiter = static_cast<const char*>(std::memchr(line.data(), configDelimiter, line.size()));
+			if (!delimiter) continue;
+			const size_t pos = static_cast<size_t>(delimiter - line.data());
+			const std::string_view token = line.substr(0, pos);
+			std::string_view value = line.substr(pos + 1);
+
+			// a last line without a line break may be an append cut short by a crash, it is only used if its value is
+			// complete. Quotes inside values are escaped, so a closing quote is never preceded by a backslash.
+			const bool opensQuote = !value.empty() && (value.front() == '\"' || value.front() == '\'');
+			const bool closesQuote = value.size() >= 2 && value.back() == value.front()
+				&& (value.front() != '\"' || value[value.size() - 2] != '\\');
+			if (!newline && (value.empty() || (opensQuote && !closesQuote))) continue;
+
+			const bool doubleQuoted = value.size() >= 2 && value.front() == '\"' && value.back() == '\"';
+			if (value.size() >= 2 && (value.front() == '\"' || value.front() == '\'') && value.back() == value.front())
+			{
+				value = value.substr(1, value.size() - 2);
+			}
+			if (!hasQuote(token) && !hasQuote(value))
+			{
+				f(ConfigEntry{ token, value, lineOffset, lineLength, static_cast<size_t>(value.data() - content.data()) });
+				continue;
+			}
+
+			// slow path, \" inside a double quoted value is a quote written by appendConfigLine, every other
+			// quotation mark is removed
+			scratch.clear();
+			for (const char c : token) if (c != '\"' && c != '\'') scratch += c;
+			const size_t tokenSize = scratch.size();
+			for (size_t i = 0; i < value.size(); i++)
+			{
+				if (doubleQuoted && value[i] == '\\' && i + 1 < value.size() && value[i + 1] == '\"') scratch += value[++i];
+				else if (value[i] != '\"' && value[i] != '\'') scratch += value[i];
+			}
+			f(ConfigEntry{ std::string_view{ scratch }.substr(0, tokenSize), std::string_view{ scratch }.substr(tokenSize),
+				lineOffset, lineLength, std::string_view::npos });
+		}
+	}
+
+	void applyConfigValue(const ConfigEntry& entry)
+	{
+		const uint64_t hash = hashName(entry.token);
+		auto& pending = getPendingConfig();
+		ccli::VarBase* var;
+		std::optional<ccli::VarPin> pin;
+		{
+			// the registry lock is held while the value is remembered, so a var registered meanwhile still sees it
+			std::shared_lock lock{ getRegistryMutex() };
+			var = getLongNameVarMap().find(entry.token, hash);
+			if (var) pin.emplace(*var);
+			if (!var || pending.count.load(std::memory_order_acquire))
+			{
+				std::unique_lock pendingLock{ getPendingConfigMutex() };
+				if (var)
+				{
+					// the var already exists, an older value must not be applied to a later var of the same name
+					if (const auto it = pending.values.find(entry.token); it != pending.values.end()) pending.values.erase(it);
+				}
+				else pending.values.insert_or_assign(std::string{ entry.token }, entry.value);
+				pending.count.store(pending.values.size(), std::memory_order_release);
+			}
+		}
+		// also check rd
+		if (var && (var->isConfigRead() || var->isConfigReadWrite())) var->valueString(entry.value);
+	}
+
+	// Writes the content to a temporary file, flushes it to disk and renames it over the config, so a crash
+	// leaves either the old or the new file behind
+	void writeConfigFile(std::string const& filename, const std::string_view content)
+	{
+		// unique per process and call, other processes or the config writer may replace the same file meanwhile
+		static std::atomic<uint32_t> tmpCounter{ 0 };
+#ifdef _WIN32
+		const auto processId = static_cast<unsigned long>(GetCurrentProcessId());
+#else
+		const auto processId = static_cast<unsigned long>(getpid());
+#endif
+		const std::string tmpFilename = filename + "." + std::to_string(processId) + "." + std::to_string(tmpCounter++) + ".tmp";
+#ifdef _WIN32
+		const HANDLE file = CreateFileA(tmpFilename.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (file == INVALID_HANDLE_VALUE) throw ccli::FileError{ filename };
+		DWORD written = 0;
+		bool success = content.empty() || (WriteFile(file, content.data(), static_cast<DWORD>(content.size()), &written, nullptr)
+			&& written == content.size());
+		success = success && FlushFileBuffers(file);
+		CloseHandle(file);
+		success = success && MoveFileExA(tmpFilename.c_str(), filename.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH);
+#else
+		const int fd = open(tmpFilename.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+		if (fd < 0) throw ccli::FileError{ filename };
+		bool success = true;
+		size_t offset = 0;
+		while (success && offset < content.size())
+		{
+			const ssize_t written = write(fd, content.data() + offset, content.size() - offset);
+			if (written < 0 && errno == EINTR) continue;
+			success = written > 0;
+			if (success) offset += static_cast<size_t>(written);
+		}
+		success = success && fsync(fd) == 0;
+		success = (close(fd) == 0) && success;
+		success = success && rename(tmpFilename.c_str(), filename.c_str()) == 0;
+		if (success)
+		{
+			// persist the rename itself, failing to do so does not lose the old file
+			const auto parent = std::filesystem::absolute(filename).parent_path();
+			const int dirFd = open(parent.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+			if (dirFd >= 0)
+			{
+				fsync(dirFd);
+				close(dirFd);
+			}
+		}
+#endif
+		if (!success)
+		{
+			std::error_code ec;
+			std::filesystem::remove(tmpFilename, ec);
+			throw ccli::FileError{ filename };
+		}
+	}
+
+	// quotes inside the value are written as \", so a line cut short right behind one is not taken for a complete one
+	void appendConfigLine(std::string& out, const std::string_view token, const std::string_view value)
+	{
+		out += token;
+		out += configDelimiter;
+		out += '\"';
+		for (size_t current = 0; current < value.size();)
+		{
+			const size_t quote = std::min(value.find('\"', current), value.size());
+			out += value.substr(current, quote - current);
+			if (quote == value.size()) break;
+			out += "\\\"";
+			current = quote + 1;
+		}
+		out += "\"\n";
+	}
+
+	/*
+	** incremental config writing
+	*/
+	struct FileIdentity
+	{
+		uintmax_t size{ 0 };
+		std::filesystem::file_time_type time{};
+		bool operator==(const FileIdentity&) const = default;
+	};
+
+	std::optional<FileIdentity> fileIdentity(const std::string& path)
+	{
+		std::error_code ec;
+		FileIdentity identity{ std::filesystem::file_size(path, ec), {} };
+		if (ec) return {};
+		identity.time = std::filesystem::last_write_time(path, ec);
+		if (ec) return {};
+		return identity;
+	}
+
+	// position of an entry inside a config file written or loaded by this process
+	struct ConfigSpan
+	{
+		size_t valueOffset;		// npos if the value cannot be patched in place
+		size_t valueLength;
+		size_t lineLength;
+	};
+
+	struct ConfigLayout
+	{
+		FileIdentity identity;
+		std::map<std::string, ConfigSpan, std::less<>> spans;
+		size_t staleBytes{ 0 };		// lines superseded by entries appended to the end of the file
+		bool endsWithLineBreak{ true };	// otherwise appended lines need a leading line break
+	};
+
+	std::map<std::string, ConfigLayout, std::less<>>& getConfigLayouts()
+	{
+		static std::map<std::string, ConfigLayout, std::less<>> layouts;
+		return layouts;
+	}
+
+	// always a real mutex, the layouts are also updated by the config writer thread
+	std::mutex& getConfigLayoutMutex()
+	{
+		static std::mutex mutex;
+		return mutex;
+	}
+
+	// later entries of the same token win, just like when the values are applied to the vars
+	void recordConfigSpan(ConfigLayout& layout, const ConfigEntry& entry)
+	{
+		const ConfigSpan span{ entry.valueOffset, entry.value.size(), entry.lineLength };
+		const auto [it, inserted] = layout.spans.try_emplace(std::string{ entry.token }, span);
+		if (!inserted)
+		{
+			layout.staleBytes += it->second.lineLength;
+			it->second = span;
+		}
+	}
+
+	void rememberConfigLayout(const std::string& cfgFile, const std::string_view content)
+	{
+		const auto identity = fileIdentity(cfgFile);
+		std::unique_lock lock{ getConfigLayoutMutex() };
+		auto& layouts = getConfigLayouts();
+		if (!identity)
+		{
+			layouts.erase(cfgFile);
+			return;
+		}
+		ConfigLayout layout{ *identity, {}, 0, content.empty() || content.back() == '\n' };
+		scanConfig(content, [&](const ConfigEntry& entry) { recordConfigSpan(layout, entry); });
+		layouts.insert_or_assign(cfgFile, std::move(layout));
+	}
+
+	// Calls f for every entry and remembers where the values are, so writeConfig can patch them in place
+	template <typename F>
+	void readConfigFile(const std::string& cfgFile, const MappedFile& file, F&& f)
+	{
+		const auto identity = fileIdentity(cfgFile);
+		ConfigLayout layout{ identity.value_or(FileIdentity{}), {}, 0, file.view().empty() || file.view().back() == '\n' };
+		scanConfig(file.view(), [&](const ConfigEntry& entry) {
+			f(entry);
+			recordConfigSpan(layout, entry);
+		});
+
+		std::unique_lock lock{ getConfigLayoutMutex() };
+		if (identity) getConfigLayouts().insert_or_assign(cfgFile, std::move(layout));
+		else getConfigLayouts().erase(cfgFile);
+	}
+
+	// Rewrites the whole file from the cache. Comments and the order of existing entries are kept, superseded
+	// entries are dropped and new entries are appended sorted by name.
+	std::string buildConfigContent(const std::string_view existing, const ccli::ConfigCache& cache)
+	{
+		std::string out;
+		out.reserve(existing.size());
+		std::map<std::string, bool, std::less<>> emitted;
+		size_t current = 0;
+		while (current < existing.size())
+		{
+			const size_t lineEnd = std::min(existing.find('\n', current), existing.size());
+			const std::string_view line = existing.substr(current, lineEnd - current);
+			current = lineEnd + 1;
+
+			const size_t pos = line.find(configDelimiter);
+			if (pos == std::string_view::npos)
+			{
+				out += line;
+				out += '\n';
+				continue;
+			}
+
+			std::string token{ line.substr(0, pos) };
+			std::erase(token, '\"');
+			std::erase(token, '\'');
+			if (!emitted.try_emplace(token, true).second) continue;
+			if (const auto it = cache.find(token); it != cache.end()) appendConfigLine(out, it->first, it->second);
+			else
+			{
+				out += line;
+				out += '\n';
+			}
+		}
+		for (const auto& [token, value] : cache)
+		{
+			if (!emitted.contains(token)) appendConfigLine(out, token, value);
+		}
+		return out;
+	}
+
+	// true if the file is unchanged since it was last loaded or written
+	bool isConfigLayoutCurrent(const std::string& cfgFile)
+	{
+		std::unique_lock lock{ getConfigLayoutMutex() };
+		const auto& layouts = getConfigLayouts();
+		const auto it = layouts.find(cfgFile);
+		return it != layouts.end() && fileIdentity(cfgFile) == it->second.identity;
+	}
+
+	void rewriteConfigFile(const std::string& cfgFile, const ccli::ConfigCache& cache)
+	{
+		std::string content;
+		{
+			const MappedFile file{ cfgFile };
+			content = buildConfigContent(file.view(), cache);
+		}
+		writeConfigFile(cfgFile, content);
+		rememberConfigLayout(cfgFile, content);
+	}
+
+	// value replaced at its position in the file
+	struct ConfigPatch
+	{
+		size_t offset;
+		std::string_view value;
+	};
+
+	// Overwrites the values in place, writes the appended lines behind the old end of the file and flushes it to
+	// disk. Only the changed bytes are written, whatever the size of the file. A crash may only cut off the last
+	// appended line, which the loader ignores because it lacks the line break.
+	bool writeConfigPatches(const std::string& filename, const std::span<const ConfigPatch> patches,
+		const size_t end, const std::string_view appended)
+	{
+#ifdef _WIN32
+		const HANDLE file = CreateFileA(filename.c_str(), GENERIC_WRITE, 0, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (file == INVALID_HANDLE_VALUE) return false;
+		const auto writeAt = [file](const std::string_view data, const size_t offset) {
+			OVERLAPPED overlapped{};
+			overlapped.Offset = static_cast<DWORD>(offset);
+			overlapped.OffsetHigh = static_cast<DWORD>(static_cast<uint64_t>(offset) >> 32);
+			DWORD written = 0;
+			return WriteFile(file, data.data(), static_cast<DWORD>(data.size()), &written, &overlapped) && written == data.size();
+		};
+		bool success = true;
+		for (const ConfigPatch& patch : patches) success = success && writeAt(patch.value, patch.offset);
+		success = success && (appended.empty() || writeAt(appended, end));
+		success = FlushFileBuffers(file) && success;
+		CloseHandle(file);
+		return success;
+#else
+		const int fd = open(filename.c_str(), O_WRONLY | O_CLOEXEC);
+		if (fd < 0) return false;
+		const auto writeAt = [fd](const std::string_view data, const size_t offset) {
+			size_t done = 0;
+			while (done < data.size())
+			{
+				const ssize_t written = pwrite(fd, data.data() + done, data.size() - done, static_cast<off_t>(offset + done));
+				if (written < 0 && errno == EINTR) continue;
+				if (written <= 0) return false;
+				done += static_cast<size_t>(written);
+			}
+			return true;
+		};
+		bool success = true;
+		for (const ConfigPatch& patch : patches) success = success && writeAt(patch.value, patch.offset);
+		success = success && writeAt(appended, end);
+		success = fsync(fd) == 0 && success;
+		return (close(fd) == 0) && success;
+#endif
+	}
+
+	// Values of the same length are overwritten in place, all other changes are appended, so the cost only
+	// depends on the changes. Returns false if the file has to be rewritten instead.
+	bool patchConfigFile(const std::string& cfgFile, const std::vector<const ccli::ConfigCache::value_type*>& changes)
+	{
+		std::unique_lock lock{ getConfigLayoutMutex() };
+		auto& layouts = getConfigLayouts();
+		const auto layoutIt = layouts.find(cfgFile);
+		if (layoutIt == layouts.end()) return false;
+		ConfigLayout& layout = layoutIt->second;
+		if (fileIdentity(cfgFile) != layout.identity) return false;
+
+		std::vector<ConfigPatch> patches;
+		std::string appended;
+		const size_t end = layout.identity.size;
+		// appended lines must start on a new line
+		if (!layout.endsWithLineBreak) appended += '\n';
+		const size_t lineBreakSize = appended.size();
+
+		for (const auto* change : changes)
+		{
+			const auto& [token, value] = *change;
+			const auto spanIt = layout.spans.find(token);
+			const bool patchable = value.find_first_of("\"'\n\r") == std::string::npos;
+			if (spanIt != layout.spans.end() && patchable && spanIt->second.valueOffset != std::string::npos
+				&& spanIt->second.valueLength == value.size())
+			{
+				patches.push_back({ spanIt->second.valueOffset, value });
+				continue;
+			}
+
+			const size_t lineOffset = end + appended.size();
+			appendConfigLine(appended, token, value);
+			// escaped values are not stored verbatim and cannot be patched later
+			const size_t valueOffset = value.find('\"') == std::string::npos ? lineOffset + token.size() + 2 : std::string::npos;
+			const ConfigSpan span{ valueOffset, value.size(), end + appended.size() - lineOffset };
+			if (spanIt != layout.spans.end())
+			{
+				layout.staleBytes += spanIt->second.lineLength;
+				spanIt->second = span;
+			}
+			else layout.spans.emplace(token, span);
+		}
+		if (appended.size() == lineBreakSize) appended.clear();
+
+		if (!writeConfigPatches(cfgFile, patches, end, appended))
+		{
+			layouts.erase(layoutIt);
+			throw ccli::FileError{ cfgFile };
+		}
+
+		const auto identity = fileIdentity(cfgFile);
+		if (!identity)
+		{
+			layouts.erase(layoutIt);
+			return true;
+		}
+		layout.identity = *identity;
+		layout.endsWithLineBreak = layout.endsWithLineBreak || !appended.empty();
+		// compact once most of the file consists of superseded entries
+		if (layout.staleBytes * 2 > layout.identity.size) layouts.erase(layoutIt);
+		return true;
+	}
+
+	// Updates the cache with the values of the dirty vars and returns the changed entries
+	std::vector<const ccli::ConfigCache::value_type*> updateConfigCache(ccli::ConfigCache& cache, const std::span<ccli::VarBase* const> dirtyVars)
+	{
+		std::vector<const ccli::ConfigCache::value_type*> changes;
+		std::string valueBuffer;
+		// update vars, the cache keeps the output sorted by name
+		for (auto* var : dirtyVars)
+		{
+			if (const auto* change = updateConfigCache(cache, var->longName(), formatValue(*var, valueBuffer))) changes.push_back(change);
+		}
+		return changes;
+	}
+
+	ccli::ConfigCache collectConfigVars()
+	{
+		ccli::ConfigCache cache;
+		std::string valueBuffer;
+		std::shared_lock lock{ getRegistryMutex() };
+		for (const auto& [var, slot] : getVarList().entries)
+		{
+			// also check if rdwr
+			if (var && var->isConfigReadWrite()) cache.try_emplace(std::string{ var->longName() }, formatValue(*var, valueBuffer));
+		}
+		return cache;
+	}
+
+	std::string buildConfigDump(const ccli::ConfigCache& cache)
+	{
+		std::string content;
+		for (const auto& [token, value] : cache) appendConfigLine(content, token, value);
+		return content;
+	}
+
+	/*
+	** asynchronous config writing
+	*/
+	struct ConfigWriteJob
+	{
+		// replace: entries are the whole file, otherwise they are merged into the existing file
+		ccli::ConfigCache entries;
+		bool replace{ false };
+		std::promise<void> promise;
+		std::shared_future<void> future{ promise.get_future().share() };
+	};
+
+	// Writes config files on a background thread. Requests for a file that is not written yet are merged into
+	// the pending job, so the file is written once with the latest values.
+	class ConfigWriter {
+	public:
+		ConfigWriter()
+		{
+			// the writer is destroyed first and may still use the layouts while draining
+			getConfigLayouts();
+			getConfigLayoutMutex();
+			_thread = std::thread{ [this] { run(); } };
+		}
+
+		~ConfigWriter()
+		{
+			{
+				std::unique_lock lock{ _mutex };
+				_stop = true;
+			}
+			_wake.notify_one();
+			_thread.join();
+		}
+
+		ConfigWriter(const ConfigWriter&) = delete;
+		ConfigWriter& operator=(const ConfigWriter&) = delete;
+
+		template <typename F>
+		std::shared_future<void> submit(const std::string& cfgFile, F&& update)
+		{
+			std::unique_lock lock{ _mutex };
+			const auto [it, inserted] = _pending.try_emplace(cfgFile);
+			update(it->second);
+			if (inserted) _wake.notify_one();
+			return it->second.future;
+		}
+
+		// returns the pending job of the file, or a ready future
+		std::shared_future<void> pending(const std::string& cfgFile)
+		{
+			std::unique_lock lock{ _mutex };
+			if (const auto it = _pending.find(cfgFile); it != _pending.end()) return it->second.future;
+			if (_active && *_active == cfgFile) return _activeFuture;
+			std::promise<void> promise;
+			promise.set_value();
+			return promise.get_future().share();
+		}
+
+		void flush()
+		{
+			std::unique_lock lock{ _mutex };
+			_idle.wait(lock, [this] { return _pending.empty() && !_active; });
+		}
+
+	private:
+		void run()
+		{
+			std::unique_lock lock{ _mutex };
+			while (true)
+			{
+				_wake.wait(lock, [this] { return _stop || !_pending.empty(); });
+				if (_pending.empty()) return;
+
+				auto node = _pending.extract(_pending.begin());
+				_active = node.key();
+				_activeFuture = node.mapped().future;
+				lock.unlock();
+				write(node.key(), node.mapped());
+				lock.lock();
+				_active.reset();
+				_activeFuture = {};
+				if (_pending.empty()) _idle.notify_all();
+			}
+		}
+
+		static void write(const std::string& cfgFile, ConfigWriteJob& job)
+		{
+			try
+			{
+				std::string content;
+				if (job.replace) content = buildConfigDump(job.entries);
+				else
+				{
+					const MappedFile file{ cfgFile };
+					content = buildConfigContent(file.view(), job.entries);
+				}
+				writeConfigFile(cfgFile, content);
+				rememberConfigLayout(cfgFile, content);
+				job.promise.set_value();
+			}
+			catch (...)
+			{
+				job.promise.set_exception(std::current_exception());
+			}
+		}
+
+		std::mutex _mutex;
+		std::condition_variable _wake;
+		std::condition_variable _idle;
+		std::map<std::string, ConfigWriteJob> _pending;
+		std::optional<std::string> _active;
+		std::shared_future<void> _activeFuture;
+		bool _stop{ false };
+		std::thread _thread;
+	};
+
+	ConfigWriter& getConfigWriter()
+	{
+		static ConfigWriter writer;
+		return writer;
+	}
+
+	/*
+	** binary config cache
+	*/
+	// word wise hash, only used to detect changed config files
+	uint64_t hashContent(const std::string_view content) noexcept
+	{
+		uint64_t hash = 0xcbf29ce484222325ull ^ content.size();
+		size_t i = 0;
+		for (; i + sizeof(uint64_t) <= content.size(); i += sizeof(uint64_t))
+		{
+			uint64_t word;
+			std::memcpy(&word, content.data() + i, sizeof(word));
+			hash = (hash ^ word) * 0x9e3779b97f4a7c15ull;
+			hash ^= hash >> 29;
+		}
+		for (; i < content.size(); i++) hash = (hash ^ static_cast<unsigned char>(content[i])) * 0x100000001b3ull;
+		hash ^= hash >> 32;
+		return hash;
+	}
+
+	constexpr char binaryConfigMagic[8] = { 'c', 'c', 'l', 'i', 'b', 'i', 'n', '\0' };
+	// also rejects caches written on machines with a different byte order
+	constexpr uint32_t binaryConfigVersion = 1;
+	// entries of unknown or read only vars keep the text value
+	constexpr uint32_t binaryTextType = 0;
+
+	struct BinaryConfigHeader
+	{
+		char magic[8];
+		uint32_t version;
+		uint32_t entryCount;
+		uint64_t textSize;
+		int64_t textTime;
+		uint64_t textHash;
+		uint64_t payloadHash;
+	};
+
+	struct BinaryConfigEntryHeader
+	{
+		uint32_t tokenLength;
+		uint32_t type;
+		uint32_t varSize;
+		uint32_t count;
+		uint32_t dataLength;
+	};
+
+	struct BinaryConfigEntry
+	{
+		std::string_view token;
+		BinaryConfigEntryHeader header;
+		std::string_view data;
+	};
+
+	BinaryConfigHeader makeBinaryConfigHeader(const FileIdentity& identity, const uint64_t textHash)
+	{
+		BinaryConfigHeader header{};
+		std::memcpy(header.magic, binaryConfigMagic, sizeof(header.magic));
+		header.version = binaryConfigVersion;
+		header.textSize = identity.size;
+		header.textTime = static_cast<int64_t>(identity.time.time_since_epoch().count());
+		header.textHash = textHash;
+		return header;
+	}
+
+	void appendBinaryConfigEntry(std::string& out, const std::string_view token, BinaryConfigEntryHeader header, const std::string_view data)
+	{
+		header.tokenLength = static_cast<uint32_t>(token.size());
+		header.dataLength = static_cast<uint32_t>(data.size());
+		out.append(reinterpret_cast<const char*>(&header), sizeof(header));
+		out += token;
+		out += data;
+	}
+
+	// Returns the entries of the cache, or nothing if it does not belong to the text file or is damaged
+	std::optional<std::vector<BinaryConfigEntry>> readBinaryConfig(const std::string_view content, const BinaryConfigHeader& expected)
+	{
+		BinaryConfigHeader header;
+		if (content.size() < sizeof(header)) return {};
+		std::memcpy(&header, content.data(), sizeof(header));
+		if (std::memcmp(header.magic, expected.magic, sizeof(header.magic)) != 0 || header.version != expected.version
+			|| header.textSize != expected.textSize || header.textTime != expected.textTime || header.textHash != expected.textHash)
+		{
+			return {};
+		}
+
+		const std::string_view payload = content.substr(sizeof(header));
+		if (hashContent(payload) != header.payloadHash) return {};
+
+		std::vector<BinaryConfigEntry> entries;
+		entries.reserve(header.entryCount);
+		size_t pos = 0;
+		for (uint32_t i = 0; i < header.entryCount; i++)
+		{
+			BinaryConfigEntry entry{};
+			if (payload.size() - pos < sizeof(entry.header)) return {};
+			std::memcpy(&entry.header, payload.data() + pos, sizeof(entry.header));
+			pos += sizeof(entry.header);
+			if (payload.size() - pos < static_cast<size_t>(entry.header.tokenLength) + entry.header.dataLength) return {};
+			entry.token = payload.substr(pos, entry.header.tokenLength);
+			entry.data = payload.substr(pos + entry.header.tokenLength, entry.header.dataLength);
+			pos += entry.token.size() + entry.data.size();
+			entries.push_back(entry);
+		}
+		if (pos != payload.size()) return {};
+		return entries;
+	}
+
+	// number of elements valueString assigns for the string
+	size_t countConfigElements(const std::string_view value, const size_t maxSize)
+	{
+		return std::min(static_cast<size_t>(std::count(value.begin(), value.end(), ',')) + 1, maxSize);
+	}
+}
+
+namespace
+{
+	constexpr size_t maxResponseFileDepth = 16;
+
+	bool isArgSpace(const char c) noexcept
+	{
+		return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v';
+	}
+
+	// Calls f for every token. Tokens are separated by whitespace, quotes group them and a backslash escapes the next
+	// character (except in single quotes). Plain tokens are passed on as views into the content, only the others are
+	// unquoted into the scratch buffer.
+	template <typename F>
+	void forEachArgToken(const std::string_view content, std::string& scratch, F&& f)
+	{
+		size_t pos = 0;
+		while (true)
+		{
+			while (pos < content.size() && isArgSpace(content[pos])) pos++;
+			if (pos >= content.size()) break;
+
+			const size_t start = pos;
+			while (pos < content.size() && !isArgSpace(content[pos]) && content[pos] != '"' && content[pos] != '\''
+				&& content[pos] != '\\')
+			{
+				pos++;
+			}
+			if (pos == content.size() || isArgSpace(content[pos]))
+			{
+				f(content.substr(start, pos - start));
+				continue;
+			}
+
+			scratch.assign(content.substr(start, pos - start));
+			char quote = '\0';
+			for (; pos < content.size(); pos++)
+			{
+				const char c = content[pos];
+				if (!quote && isArgSpace(c)) break;
+				if (quote ? c == quote : (c == '"' || c == '\'')) quote = quote ? '\0' : c;
+				else if (c == '\\' && quote != '\'' && pos + 1 < content.size()) scratch += content[++pos];
+				else scratch += c;
+			}
+			f(std::string_view{ scratch });
+		}
+	}
+}
+
+namespace
+{
+	// conversion errors are thrown once all arguments were applied, a callback may have destroyed the var meanwhile.
+	// It is looked up again by the option which named it.
+	[[noreturn]] void throwConversionError(const std::string& option, const std::string& value)
+	{
+		const std::string_view name{ option };
+		const ccli::VarBase* var = name.starts_with("--") ? findVarByLongName(name.substr(2)) : findVarByShortName(name.substr(1));
+		if (!var) throw ccli::UnknownArgError{ option };
+		throw ccli::ConversionError{ *var, value };
+	}
+}
+
+void ccli::parseArgs(const size_t argc, const char* const argv[])
+{
+	ParseContext context{ ParseContext::ProgramName::Detect };
+	if (!context.parse(argc, argv)) context.throwFirstError();
+}
+
+void ccli::parseLine(const std::string_view line)
+{
+	// one context per thread, so repeated calls reuse its buffers
+	thread_local ParseContext context;
+	if (!context.parseLine(line)) context.throwFirstError();
+}
+
+void ccli::parseLines(const std::string_view script)
+{
+	thread_local ParseContext context;
+	if (!context.parseLines(script)) context.throwFirstError();
+}
+
+ccli::ParseContext::ParseContext(const ProgramName programName) : _programName{ programName } {}
+
+bool ccli::ParseContext::parse(const size_t argc, const char* const argv[])
+{
+	size_t i = 0;
+	if (argc > 0)
+	{
+		// check if first arg is exe
+		if (_programName == ProgramName::Skip) i++;
+		else if (_programName == ProgramName::Detect && std::filesystem::exists(std::filesystem::status(std::string_view{ argv[0] })))
+		{
+			i++;
+		}
+	}
+
+	begin();
+	for (; i < argc; i++) feedArg(argv[i], 0);
+	return finish();
+}
+
+bool ccli::ParseContext::parse(const std::span<const std::string_view> args)
+{
+	begin();
+	for (const auto arg : args) feedArg(arg, 0);
+	return finish();
+}
+
+bool ccli::ParseContext::parseLine(const std::string_view line)
+{
+	begin();
+	forEachArgToken(line, _scratch, [this](const std::string_view token) { feed(token); });
+	return finish();
+}
+
+bool ccli::ParseContext::parseLines(const std::string_view script)
+{
+	begin();
+	size_t pos = 0;
+	while (pos < script.size())
+	{
+		const char* lineEnd = static_cast<const char*>(std::memchr(script.data() + pos, '\n', script.size() - pos));
+		const size_t end = lineEnd ? static_cast<size_t>(lineEnd - script.data()) : script.size();
+		const std::string_view line = script.substr(pos, end - pos);
+		pos = end + 1;
+		_line++;
+
+		// every line is a command of its own, lines starting with '#' are comments
+		const size_t first = line.find_first_not_of(" \t\r");
+		if (first == std::string_view::npos || line[first] == '#') continue;
+		forEachArgToken(line, _scratch, [this](const std::string_view token) { feed(token); });
+		valuelessVar();
+		_var = nullptr;
+		_idxOffset = 0;
+	}
+	_line = 0;
+	return finish();
+}
+
+void ccli::ParseContext::throwFirstError() const
+{
+	if (!_errorCount) return;
+	const Error& error = _errors.front();
+	switch (error.kind)
+	{
+	case Error::Kind::UnknownArg: throw UnknownArgError{ error.argument };
+	case Error::Kind::MissingValue: throw MissingValueError{ error.argument };
+	case Error::Kind::Conversion: throwConversionError(error.option, error.argument);
+	case Error::Kind::File: throw FileError{ error.argument, FileError::Kind::ResponseFile };
+	}
+}
+
+void ccli::ParseContext::begin()
+{
+	_errorCount = 0;
+	_var = nullptr;
+	_idxOffset = 0;
+	_line = 0;
+
+	validateCache();
+}
+
+// cached vars may have been destroyed since the last lookup, also by a callback run during this parse
+void ccli::ParseContext::validateCache()
+{
+	const uint64_t generation = getRegistryGeneration().load(std::memory_order_acquire);
+	if (generation == _cacheGeneration) return;
+	std::fill(_cache.begin(), _cache.end(), CachedVar{});
+	_cachedCount = 0;
+	_cacheGeneration = generation;
+
+	// the pointer is only compared, the var it pointed to may be gone
+	if (_var)
+	{
+		const std::string_view option{ _option };
+		const VarBase* var = option.starts_with("--") ? findVarByLongName(option.substr(2)) : findVarByShortName(option.substr(1));
+		if (var != _var) _var = nullptr;
+	}
+}
+
+bool ccli::ParseContext::finish()
+{
+	// Var is last argument
+	valuelessVar();
+	return _errorCount == 0;
+}
+
+void ccli::ParseContext::addError(const Error::Kind kind, const std::string_view argument, const std::string_view option)
+{
+	// the error entries and their strings are reused by later parses
+	if (_errorCount == _errors.size()) _errors.emplace_back();
+	Error& error = _errors[_errorCount++];
+	error.kind = kind;
+	error.argument.assign(argument);
+	error.option.assign(option);
+	error.line = _line;
+}
+
+ccli::VarBase* ccli::ParseContext::findVar(const std::string_view name, const bool shortName)
+{
+	validateCache();
+	const uint64_t hash = hashName(name) ^ (shortName ? 0x9e3779b97f4a7c15ull : 0);
+	const auto matches = [&](const VarBase& var) { return (shortName ? var.shortName() : var.longName()) == name; };
+	if (!_cache.empty())
+	{
+		for (size_t i = hash & (_cache.size() - 1); _cache[i].var; i = (i + 1) & (_cache.size() - 1))
+		{
+			if (_cache[i].hash == hash && _cache[i].shortName == shortName && matches(*_cache[i].var)) return _cache[i].var;
+		}
+	}
+
+	VarBase* var = shortName ? findVarByShortName(name) : findVarByLongName(name);
+	if (!var) return nullptr;
+
+	// only vars which were found are cached, so vars registered later are still found
+	if ((_cachedCount + 1) * 2 > _cache.size())
+	{
+		std::vector<CachedVar> old(_cache.empty() ? 64 : _cache.size() * 2);
+		old.swap(_cache);
+		for (const CachedVar& cached : old)
+		{
+			if (!cached.var) continue;
+			size_t i = cached.hash & (_cache.size() - 1);
+			while (_cache[i].var) i = (i + 1) & (_cache.size() - 1);
+			_cache[i] = cached;
+		}
+	}
+	size_t i = hash & (_cache.size() - 1);
+	while (_cache[i].var) i = (i + 1) & (_cache.size() - 1);
+	_cache[i] = { hash, var, shortName };
+	_cachedCount++;
+	return var;
+}
+
+void ccli::ParseContext::setValue(VarBase& var, const std::string_view option, const std::string_view value)
+{
+	try
+	{
+		_idxOffset = var.setValueStringInternal(value, _idxOffset);
+	}
+	catch (const ConversionError& e)
+	{
+		addError(Error::Kind::Conversion, e.unconvertibleValueString(), option);
+		// the value was given, it is not reported as missing as well
+		_idxOffset++;
+	}
+	// the callback of the var may have destroyed vars, including this one
+	validateCache();
+}
+
+void ccli::ParseContext::feed(const std::string_view arg)
+{
+	const bool shortName = arg.size() >= 2 ? arg[0] == '-' && isalpha(arg[1]) : false;
+	const bool longName = arg.size() >= 2 ? arg[0] == '-' && arg[1] == '-' : false;
+	if (shortName || longName)
+	{
+		valuelessVar();
+
+		// find new arg
+		_var = nullptr;
+		_idxOffset = 0;
+
+		// --var=123 cases
+		if (longName)
+		{
+			if (const std::size_t found = arg.find_first_of('='); found != std::string::npos)
+			{
+				VarBase* var = findVar(arg.substr(2, found - 2), false);
+				if (!var) addError(Error::Kind::UnknownArg, arg);
+				else if (arg.size() <= (found + 1)) addError(Error::Kind::MissingValue, arg);
+				else setValue(*var, arg.substr(0, found), arg.substr(found + 1));
+				_idxOffset = 0;
+				return;
+			}
+		}
+
+		_var = longName ? findVar(arg.substr(2), false) : findVar(arg.substr(1), true);
+
+		// error if not found -> report it after parsing the rest of the arguments
+		if (_var == nullptr) addError(Error::Kind::UnknownArg, arg);
+		// the token may not outlive this call, e.g. if it comes from a response file
+		else _option.assign(arg);
+	}
+	// Var found
+	else if (_var)
+	{
+		setValue(*_var, _option, arg);
+	}
+}
+
+namespace
+{
+	// Arg without value is only allowed for bools
+	bool isSwitch(const ccli::VarBase& var)
+	{
+		return var.isBool() && var.size() == 1 && !var.isDynamic();
+	}
+}
+
+void ccli::ParseContext::valuelessVar()
+{
+	if (_var && _idxOffset == 0)
+	{
+		if (isSwitch(*_var))
+		{
+			_var->setValueStringInternal("");
+			return;
+		}
+		addError(Error::Kind::MissingValue, _option);
+	}
+}
+
+// the argument is the value of the previous option, e.g. '--mail @home'
+bool ccli::ParseContext::isWaitingForValue() const
+{
+	return _var && _idxOffset == 0 && !isSwitch(*_var);
+}
+
+// '@file' arguments are replaced by the tokens of the file unless they are the value of an option, '@@' stands for '@'
+void ccli::ParseContext::feedArg(const std::string_view arg, const size_t depth)
+{
+	if (arg.size() > 1 && arg[0] == '@' && arg[1] == '@') feed(arg.substr(1));
+	else if (arg.size() > 1 && arg[0] == '@' && !isWaitingForValue()) feedResponseFile(std::string{ arg.substr(1) }, depth + 1);
+	else feed(arg);
+}
+
+// the tokens stay views into the mapped file unless they have to be unquoted
+void ccli::ParseContext::feedResponseFile(const std::string& path, const size_t depth)
+{
+	if (depth > maxResponseFileDepth || !std::filesystem::is_regular_file(path))
+	{
+		addError(Error::Kind::File, path);
+		return;
+	}
+
+	const MappedFile file{ path };
+	forEachArgToken(file.view(), _scratch, [&](const std::string_view token) { feedArg(token, depth); });
+}
+
+namespace
+{
+	// names match ignoring case, '_' and '-', so APP_FOO_BAR finds fooBar, foo_bar and foo-bar
+	bool isNameSeparator(const char c) noexcept
+	{
+		return c == '_' || c == '-';
+	}
+
+	char lowerNameChar(const char c) noexcept
+	{
+		return c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c;
+	}
+
+	uint64_t hashNormalizedName(const std::string_view name) noexcept
+	{
+		uint64_t hash = 0xcbf29ce484222325ull;
+		for (const char c : name)
+		{
+			if (isNameSeparator(c)) continue;
+			hash ^= static_cast<unsigned char>(lowerNameChar(c));
+			hash *= 0x100000001b3ull;
+		}
+		hash ^= hash >> 32;
+		return hash;
+	}
+
+	bool normalizedNamesEqual(const std::string_view a, const std::string_view b) noexcept
+	{
+		size_t i = 0;
+		size_t j = 0;
+		while (true)
+		{
+			while (i < a.size() && isNameSeparator(a[i])) i++;
+			while (j < b.size() && isNameSeparator(b[j])) j++;
+			if (i == a.size() || j == b.size()) return i == a.size() && j == b.size();
+			if (lowerNameChar(a[i++]) != lowerNameChar(b[j++])) return false;
+		}
+	}
+
+	// long names of all registered vars, keyed by their normalized form
+	class NormalizedNameIndex {
+	public:
+		struct Slot
+		{
+			uint64_t hash{ 0 };
+			ccli::VarBase* var{ nullptr };
+			// another var whose name normalizes to the same string, e.g. fooBar and foo_bar
+			ccli::VarBase* collision{ nullptr };
+		};
+
+		void build(const std::vector<VarListEntry>& entries)
+		{
+			size_t size = 16;
+			while (size < entries.size() * 2) size *= 2;
+			_slots.assign(size, {});
+			for (const auto& [var, slot] : entries)
+			{
+				if (!var || var->longName().empty()) continue;
+				const uint64_t hash = hashNormalizedName(var->longName());
+				size_t i = hash & (_slots.size() - 1);
+				for (; _slots[i].var; i = (i + 1) & (_slots.size() - 1))
+				{
+					if (_slots[i].hash == hash && normalizedNamesEqual(_slots[i].var->longName(), var->longName())) break;
+				}
+				if (!_slots[i].var) _slots[i] = { hash, var, nullptr };
+				else if (!_slots[i].collision) _slots[i].collision = var;
+			}
+		}
+
+		[[nodiscard]] const Slot* find(const std::string_view name) const noexcept
+		{
+			if (_slots.empty()) return nullptr;
+			const uint64_t hash = hashNormalizedName(name);
+			for (size_t i = hash & (_slots.size() - 1);; i = (i + 1) & (_slots.size() - 1))
+			{
+				const Slot& slot = _slots[i];
+				if (!slot.var) return nullptr;
+				if (slot.hash == hash && normalizedNamesEqual(slot.var->longName(), name)) return &slot;
+			}
+		}
+
+	private:
+		std::vector<Slot> _slots;
+	};
+
+	// Built on demand and kept until vars are registered or unregistered. Vars are only added to the end of the var
+	// list and every removal changes the registry generation, so both together identify the registered vars.
+	struct NormalizedNameCache
+	{
+		NormalizedNameIndex index;
+		uint64_t generation{ 0 };
+		size_t listSize{ 0 };
+		bool built{ false };
+	};
+
+	NormalizedNameCache& getNormalizedNameCache()
+	{
+		static NormalizedNameCache cache;
+		return cache;
+	}
+
+	// guards the normalized name cache, taken while the registry lock is held
+	CallbackMutex& getNormalizedNameMutex()
+	{
+		static CallbackMutex mutex;
+		return mutex;
+	}
+}
+
+void ccli::parseEnv(const std::string_view prefix)
+{
+	// single pass over the environment, most processes have few or no variables with the prefix
+	std::vector<std::pair<std::string_view, std::string_view>> entries;
+#ifdef _WIN32
+	char** const env = _environ;
+#else
+	char** const env = environ;
+#endif
+	for (char* const* it = env; it && *it; it++)
+	{
+		const std::string_view entry{ *it };
+		if (!entry.starts_with(prefix)) continue;
+		const size_t found = entry.find('=', prefix.size());
+		if (found == std::string_view::npos || found == prefix.size()) continue;
+		entries.emplace_back(entry.substr(prefix.size(), found - prefix.size()), entry.substr(found + 1));
+	}
+	if (entries.empty()) return;
+
+	std::vector<std::pair<VarBase*, std::string_view>> matches;
+	std::string_view unknown;
+	std::string_view ambiguous;
+	{
+		std::shared_lock lock{ getRegistryMutex() };
+		const auto& list = getVarList().entries;
+		std::lock_guard cacheLock{ getNormalizedNameMutex() };
+		auto& cache = getNormalizedNameCache();
+		const uint64_t generation = getRegistryGeneration().load(std::memory_order_acquire);
+		if (!cache.built || cache.generation != generation || cache.listSize != list.size())
+		{
+			cache.index.build(list);
+			cache.generation = generation;
+			cache.listSize = list.size();
+			cache.built = true;
+		}
+		for (const auto& [name, value] : entries)
+		{
+			const auto* slot = cache.index.find(name);
+			// a variable which matches several vars sets none of them
+			if (slot && slot->collision)
+			{
+				if (ambiguous.empty()) ambiguous = name;
+			}
+			else if (slot) matches.emplace_back(slot->var, value);
+			else if (unknown.empty()) unknown = name;
+		}
+	}
+
+	// same rules as parseArgs, all values are applied before the first error is thrown. A conversion error only
+	// keeps the name of the var, which may be destroyed by a later callback.
+	std::exception_ptr deferredError;
+	std::string conversionOption;
+	std::string conversionValue;
+	if (!unknown.empty()) deferredError = std::make_exception_ptr(UnknownArgError{ std::string{ prefix } + std::string{ unknown } });
+	else if (!ambiguous.empty()) deferredError = std::make_exception_ptr(AmbiguousArgError{ std::string{ prefix } + std::string{ ambiguous } });
+	for (const auto& [var, value] : matches)
+	{
+		try
+		{
+			if (value.empty() && !var->isBool() && !var->isString()) throw MissingValueError{ std::string{ var->longName() } };
+			var->setValueStringInternal(value);
+		}
+		catch (const ConversionError& e)
+		{
+			if (deferredError || !conversionOption.empty()) continue;
+			conversionOption = "--" + std::string{ var->longName() };
+			conversionValue = e.unconvertibleValueString();
+		}
+		catch (const CCLIError&)
+		{
+			if (!deferredError && conversionOption.empty()) deferredError = std::current_exception();
+		}
+	}
+	if (deferredError) std::rethrow_exception(deferredError);
+	if (!conversionOption.empty()) throwConversionError(conversionOption, conversionValue);
+}
+
+ccli::ConfigCache ccli::loadConfig(const std::string& cfgFile)
+{
+	ConfigCache configMap;
+	const MappedFile file{ cfgFile };
+	readConfigFile(cfgFile, file, [&](const ConfigEntry& entry) {
+		applyConfigValue(entry);
+		configMap.insert_or_assign(std::string{ entry.token }, entry.value);
+	});
+	return configMap;
+}
+
+ccli::LayeredConfig ccli::loadConfigLayers(std::vector<std::string> cfgFiles)
+{
+	// the entries stay views into the mapped files, only unquoted values are copied
+	struct ParsedLayer
+	{
+		explicit ParsedLayer(const std::string& cfgFile) : file{ cfgFile } {}
+		MappedFile file;
+		std::vector<std::pair<std::string_view, std::string_view>> entries;
+		std::deque<std::string> copies;
+	};
+
+	// parse all files in parallel, the vars are only touched once the values are merged
+	std::vector<std::unique_ptr<ParsedLayer>> layers(cfgFiles.size());
+	std::vector<std::future<void>> parsing;
+	parsing.reserve(cfgFiles.size());
+	for (size_t i = 0; i < cfgFiles.size(); i++)
+	{
+		parsing.push_back(std::async(std::launch::async, [&, i] {
+			auto layer = std::make_unique<ParsedLayer>(cfgFiles[i]);
+			readConfigFile(cfgFiles[i], layer->file, [&](const ConfigEntry& entry) {
+				if (entry.valueOffset != std::string_view::npos) layer->entries.emplace_back(entry.token, entry.value);
+				else
+				{
+					const std::string& token = layer->copies.emplace_back(entry.token);
+					layer->entries.emplace_back(token, layer->copies.emplace_back(entry.value));
+				}
+			});
+			layers[i] = std::move(layer);
+		}));
+	}
+	for (auto& future : parsing) future.get();
+
+	// the last entry of the last layer wins, so the first occurrence walking backwards is kept
+	LayeredConfig config{ std::move(cfgFiles), {}, {} };
+	for (size_t layer = layers.size(); layer-- > 0;)
+	{
+		const auto& entries = layers[layer]->entries;
+		for (auto entry = entries.rbegin(); entry != entries.rend(); ++entry)
+		{
+			const auto it = config.cache.lower_bound(entry->first);
+			if (it != config.cache.end() && it->first == entry->first) continue;
+			config.cache.emplace_hint(it, entry->first, entry->second);
+			config.origins.emplace(entry->first, layer);
+		}
+	}
+
+	for (const auto& [token, value] : config.cache) applyConfigValue(ConfigEntry{ token, value, 0, 0, std::string_view::npos });
+	return config;
+}
+
+void ccli::applyConfig(const std::string& cfgFile)
+{
+	const MappedFile file{ cfgFile };
+	scanConfig(file.view(), applyConfigValue);
+}
+
+void ccli::applyConfigCached(const std::string& cfgFile)
+{
+	const std::string binaryFile = cfgFile + ".bin";
+	const MappedFile file{ cfgFile };
+	const auto identity = fileIdentity(cfgFile);
+	if (!identity)
+	{
+		applyConfig(cfgFile);
+		return;
 	}
+	BinaryConfigHeader header = makeBinaryConfigHeader(*identity, hashContent(file.view()));
 
-	void addToVarList(const std::string& longName, const std::string& shortName, ccli::VarBase* const aVar)
+	// fast path, the values parsed by a previous run are copied into the vars
+	if (const MappedFile binary{ binaryFile }; const auto entries = readBinaryConfig(binary.view(), header))
 	{
-		auto& mapLong = getLongNameVarMap();
-		auto& mapShort = getShortNameVarMap();
-
-		std::optional<std::pair<MapType::iterator, bool>> pairShort;
-		std::optional<std::pair<MapType::iterator, bool>> pairLong;
-		if (!shortName.empty())
+		// check the schema and the data of every var before any value is applied, a damaged cache falls back to the
+		// text without leaving some of its values applied
+		std::vector<VarBase*> vars(entries->size(), nullptr);
+		bool valid = true;
+		for (size_t i = 0; i < entries->size() && valid; i++)
 		{
-			pairShort= mapShort.insert(std::pair<std::string, ccli::VarBase*>(shortName, aVar));
+			const auto& entry = (*entries)[i];
+			if (entry.header.type == binaryTextType) continue;
+			vars[i] = findVarByLongName(entry.token);
+			valid = vars[i] && (vars[i]->isConfigRead() || vars[i]->isConfigReadWrite())
+				&& vars[i]->binaryType() == entry.header.type && (vars[i]->isDynamic() || vars[i]->size() == entry.header.varSize)
+				&& vars[i]->checkBinaryValue(entry.data, entry.header.count);
 		}
-
-		if ((!pairShort.has_value() || pairShort->second) && !longName.empty())
+		if (valid)
 		{
-			pairLong = mapLong.insert(std::pair<std::string, ccli::VarBase*>(longName, aVar));
-		}
-
-		if ((pairShort.has_value() && !pairShort->second) || (pairLong.has_value() && !pairLong->second)) {
-			if (pairShort.has_value() && pairShort->second) {
-				mapShort.erase(pairShort->first);
+			for (size_t i = 0; i < entries->size(); i++)
+			{
+				const auto& entry = (*entries)[i];
+				if (!vars[i]) applyConfigValue(ConfigEntry{ entry.token, entry.data, 0, 0, std::string_view::npos });
+				else if (!vars[i]->loadBinaryValue(entry.data, entry.header.count)) throw FileError{ binaryFile };
 			}
-
-			assert(!(pairLong.has_value() && pairLong->second));
-			throw ccli::DuplicatedVarNameError{ (pairShort.has_value() && !pairShort->second) ? shortName : longName };
+			return;
 		}
-
-		getVarList().push_back(aVar);
 	}
 
-	void removeFromVarList(const std::string_view longName, const std::string_view shortName,
-		const ccli::VarBase* const aVar)
+	// slow path, parse the text and remember the resulting values for the next run, later entries of a name win
+	std::vector<std::pair<std::string, std::string>> entries;
+	std::map<std::string, size_t, std::less<>> lastEntry;
+	scanConfig(file.view(), [&](const ConfigEntry& entry) {
+		applyConfigValue(entry);
+		const auto [it, inserted] = lastEntry.try_emplace(std::string{ entry.token }, entries.size());
+		if (inserted) entries.emplace_back(entry.token, entry.value);
+		else entries[it->second].second = entry.value;
+	});
+
+	std::string payload;
+	std::string data;
+	for (const auto& [token, value] : entries)
 	{
-		auto& mapLong = getLongNameVarMap();
-		auto& mapShort = getShortNameVarMap();
-		auto& varList = getVarList();
-
-		if (!longName.empty())
+		VarBase* var = findVarByLongName(token);
+		const bool typed = var && (var->isConfigRead() || var->isConfigReadWrite()) && !var->isReadOnly() && !var->isCliOnly()
+			&& !var->isLocked() && (!value.empty() || var->isBool() || var->isString());
+		// the parsed text is stored, not the value of the var, which may differ because of limits or callbacks
+		size_t count = 0;
+		bool converted = typed;
+		data.clear();
+		if (typed)
 		{
-			const auto it = mapLong.find(longName);
-			if (it != mapLong.end() && it->second == aVar) mapLong.erase(it);
+			count = var->isDynamic() ? (value.empty() ? 0 : countConfigElements(value, SIZE_MAX)) : countConfigElements(value, var->size());
+			try
+			{
+				var->encodeBinaryValue(data, value, count);
+			}
+			catch (const ConversionError&)
+			{
+				converted = false;
+			}
 		}
-		if (!shortName.empty())
+		if (!converted)
 		{
-			const auto it = mapShort.find(shortName);
-			if (it != mapShort.end() && it->second == aVar) mapShort.erase(it);
-		}
-
-		const auto it = std::find(varList.begin(), varList.end(), aVar);
-		if (it != varList.end()) {
-			varList.erase(it);
+			appendBinaryConfigEntry(payload, token, { 0, binaryTextType, 0, 0, 0 }, value);
+			continue;
 		}
+		appendBinaryConfigEntry(payload, token,
+			{ 0, var->binaryType(), static_cast<uint32_t>(var->size()), static_cast<uint32_t>(count), 0 }, data);
 	}
 
-	/*
-	** callbacks
-	*/
-	// contains static list keeping track of all callbacks
-	std::set<ccli::VarBase*>& getCallbackSet()
+	header.entryCount = static_cast<uint32_t>(entries.size());
+	header.payloadHash = hashContent(payload);
+	std::string content(reinterpret_cast<const char*>(&header), sizeof(header));
+	content += payload;
+	try
 	{
-		static std::set<ccli::VarBase*> set;
-		return set;
+		writeConfigFile(binaryFile, content);
 	}
-
-	void addToCallbackSet(ccli::VarBase* var)
+	catch (const FileError&)
 	{
-		auto& set = getCallbackSet();
-		set.insert(var);
+		// the cache is optional, e.g. the directory may be read only
 	}
+}
 
-	void removeFromCallbackSet(ccli::VarBase* var)
-	{
-		auto& set = getCallbackSet();
-		set.erase(var);
-	}
+void ccli::writeConfig(const std::string& cfgFile, ConfigCache& cache)
+{
+	// the destructor of a var unregisters it under the registry lock before the value is destroyed, so the lock
+	// keeps the changed vars alive while they are formatted
+	std::shared_lock lock{ getRegistryMutex() };
+	const std::vector<VarBase*> dirtyVars = VarBase::configChangesSince(cache.changeGeneration);
+	const auto changes = updateConfigCache(cache, dirtyVars);
+	lock.unlock();
+	if (changes.empty()) return;
+
+	// only touch the changed entries if the file is still as it was last loaded or written
+	if (!patchConfigFile(cfgFile, changes)) rewriteConfigFile(cfgFile, cache);
+}
+void ccli::writeConfig(LayeredConfig& config)
+{
+	if (config.files.empty()) return;
 
-	/*
-	** config
-	*/
-	bool doesConfigVarNeedUpdate(ccli::ConfigCache& cache, const std::string& token, const std::string& value)
+	std::shared_lock lock{ getRegistryMutex() };
+	const std::vector<VarBase*> dirtyVars = VarBase::configChangesSince(config.cache.changeGeneration);
+	const auto changes = updateConfigCache(config.cache, dirtyVars);
+	lock.unlock();
+
+	// values are written to the layer they came from, new values to the last one
+	std::vector<std::vector<const ConfigCache::value_type*>> layerChanges(config.files.size());
+	for (const auto* change : changes)
 	{
-		const auto it = cache.find(token);
-		if (it != cache.end() && it->second != value)
-		{
-			it->second = value;
-			return true;
-		}
-		if (it == cache.end())
-		{
-			cache.insert({ token, value });
-			return true;
-		}
-		return false;
+		const auto [it, inserted] = config.origins.try_emplace(change->first, config.files.size() - 1);
+		layerChanges[std::min(it->second, config.files.size() - 1)].push_back(change);
 	}
 
-	void writeConfigFile(std::string const& filename, const std::string_view content)
+	for (size_t layer = 0; layer < layerChanges.size(); layer++)
 	{
-		std::ofstream file(filename, std::ios::out | std::ios::binary);
-		if (!file.is_open())
-		{
-			throw ccli::FileError{ filename };
-		}
-		file.write(content.data(), static_cast<std::streamsize>(content.size()));
-		file.close();
+		if (layerChanges[layer].empty()) continue;
+		const std::string& cfgFile = config.files[layer];
+		if (patchConfigFile(cfgFile, layerChanges[layer])) continue;
+
+		// other entries of the layer are taken from the file
+		ConfigCache values;
+		for (const auto* change : layerChanges[layer]) values.insert(*change);
+		rewriteConfigFile(cfgFile, values);
 	}
+}
 
-	/*
-	** parser
-	*/
-	class CSVParser {
-	public:
-		CSVParser(const std::string_view d, const char del) : _delimiter{ del }, _data{ d } {}
-
-		[[nodiscard]] bool hasNext() const
-		{
-			return _pos != std::string::npos;
-		}
-
-		[[nodiscard]] std::string_view next()
-		{
-			_pos = _data.find(_delimiter, _current);
-			_token = _data.substr(_current, _pos - _current);
-			_current = _pos + 1;
-			_count++;
-
-			return _token;
-		}
+void ccli::writeConfig(const std::string& cfgFile)
+{
+	const ConfigCache cache = collectConfigVars();
+	if (cache.empty()) return;
 
-		[[nodiscard]] size_t count() const
+	const std::string content = buildConfigDump(cache);
+	writeConfigFile(cfgFile, content);
+	rememberConfigLayout(cfgFile, content);
+}
+std::shared_future<void> ccli::writeConfigAsync(const std::string& cfgFile, ConfigCache& cache)
+{
+	// the destructor of a var unregisters it under the registry lock before the value is destroyed, so the lock
+	// keeps the changed vars alive while they are formatted
+	std::shared_lock lock{ getRegistryMutex() };
+	const std::vector<VarBase*> dirtyVars = VarBase::configChangesSince(cache.changeGeneration);
+	const auto changes = updateConfigCache(cache, dirtyVars);
+	lock.unlock();
+	if (changes.empty()) return getConfigWriter().pending(cfgFile);
+
+	// only the changes are needed if the file matches the cache, otherwise the whole cache is merged into it
+	const bool fileIsCurrent = isConfigLayoutCurrent(cfgFile);
+	return getConfigWriter().submit(cfgFile, [&](ConfigWriteJob& job) {
+		if (fileIsCurrent)
 		{
-			return _count;
+			for (const auto* change : changes) job.entries.insert_or_assign(change->first, change->second);
 		}
-
-		[[nodiscard, maybe_unused]] std::string_view token() const
+		else
 		{
-			return _token;
+			for (const auto& [token, value] : cache) job.entries.insert_or_assign(token, value);
 		}
+	});
+}
+std::shared_future<void> ccli::writeConfigAsync(const std::string& cfgFile)
+{
+	ConfigCache cache = collectConfigVars();
+	if (cache.empty()) return getConfigWriter().pending(cfgFile);
 
-	private:
-		char _delimiter;
-		size_t _count{ 0 };
-		size_t _current{ 0 };
-		size_t _pos{ 0 };
-		std::string_view _data;
-		std::string_view _token;
-	};
+	return getConfigWriter().submit(cfgFile, [&](ConfigWriteJob& job) {
+		job.entries = std::move(cache);
+		job.replace = true;
+	});
+}
+void ccli::flushConfig()
+{
+	getConfigWriter().flush();
 }
 
-void ccli::parseArgs(const size_t argc, const char* const argv[])
+ccli::ConfigWatcher::ConfigWatcher(std::string cfgFile, ConfigCache cache)
+	: _cfgFile{ std::move(cfgFile) }, _cache{ std::move(cache) }
 {
-	size_t i = 0;
-	if (argc > 0)
+#ifdef __linux__
+	// watch the directory, files replaced by a rename (editors, writeConfig) keep the watch working
+	_inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (_inotify >= 0)
 	{
-		// check if first arg is exe
-		const std::string_view exePath{ argv[0] };
-		if (std::filesystem::exists(std::filesystem::status(exePath)))
+		auto directory = std::filesystem::absolute(_cfgFile).parent_path();
+		_watch = inotify_add_watch(_inotify, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_DELETE);
+		if (_watch < 0)
 		{
-			i++;
+			close(_inotify);
+			_inotify = -1;
 		}
 	}
+#endif
+	if (const auto identity = fileIdentity(_cfgFile))
+	{
+		_size = identity->size;
+		_time = static_cast<int64_t>(identity->time.time_since_epoch().count());
+	}
+}
 
-	std::unique_ptr<CCLIError> deferredError;
-
-	std::string_view arg;
-	VarBase* var = nullptr;
-	size_t idxOffset = 0;
-	auto valuelessVar = [&]() {
-		// Arg without value is only allowed for bools
-		if (var && idxOffset == 0) {
-			if (var->isBool() && var->size() == 1) {
-				var->setValueStringInternal("");
-				return;
-			}
-
-			if (!deferredError) {
-				deferredError = std::make_unique<ccli::MissingValueError>(std::string{ arg });
-			}
-		}
-	};
+ccli::ConfigWatcher::~ConfigWatcher()
+{
+#ifdef __linux__
+	if (_inotify >= 0) close(_inotify);
+#endif
+}
 
-	for (; i < argc; i++)
+bool ccli::ConfigWatcher::changed()
+{
+#ifdef __linux__
+	if (_inotify >= 0)
 	{
-		arg= argv[i];
-		const bool shortName = arg.size() >= 2 ? arg[0] == '-' && isalpha(arg[1]) : false;
-		const bool longName = arg.size() >= 2 ? arg[0] == '-' && arg[1] == '-' : false;
-		if (shortName || longName)
+		bool fileChanged = false;
+		std::string filename;
+		alignas(inotify_event) char buffer[sizeof(inotify_event) + NAME_MAX + 1];
+		while (true)
 		{
-			valuelessVar();
-
-			// find new arg
-			var = nullptr;
-			idxOffset = 0;
-
-			// --var=123 cases
-			if (longName) {
-				if (const std::size_t found = arg.find_first_of('='); found != std::string::npos)
-				{
-					var = findVarByLongName(arg.substr(2, found - 2));
-					if(arg.size() <= (found + 1)) deferredError = std::make_unique<ccli::MissingValueError>(std::string{ arg });
-					var->setValueStringInternal(arg.substr(found + 1), idxOffset);
-					var = nullptr;
-					continue;
-				}
-			}
-
-			if (longName) var = findVarByLongName(arg.substr(2));
-			else if (shortName) var = findVarByShortName(arg.substr(1));
-			
-			// error if not found -> throw the error after parsing the rest of the arguments
-			if (var == nullptr && !deferredError) {
-				deferredError= std::make_unique<ccli::UnknownArgError>(std::string{ arg });
+			const ssize_t length = read(_inotify, buffer, sizeof(buffer));
+			if (length <= 0) break;
+			if (filename.empty()) filename = std::filesystem::path{ _cfgFile }.filename().string();
+			for (ssize_t pos = 0; pos < length;)
+			{
+				const auto* event = reinterpret_cast<const inotify_event*>(buffer + pos);
+				if (event->len && filename == event->name) fileChanged = true;
+				pos += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
 			}
 		}
-		// Var found
-		else if (var)
-		{
-			idxOffset= var->setValueStringInternal(arg, idxOffset);
-		}
+		return fileChanged;
 	}
-	
-	// Var is last argument
-	valuelessVar();
+#endif
+	const auto identity = fileIdentity(_cfgFile).value_or(FileIdentity{});
+	const auto time = static_cast<int64_t>(identity.time.time_since_epoch().count());
+	if (identity.size == _size && time == _time) return false;
+	_size = identity.size;
+	_time = time;
+	return true;
+}
 
-	// Finally throw any potential error
-	if (deferredError) {
-		deferredError->throwSelf();
-	}
+size_t ccli::ConfigWatcher::poll()
+{
+	return changed() ? reload() : 0;
 }
 
-ccli::ConfigCache ccli::loadConfig(const std::string& cfgFile)
+size_t ccli::ConfigWatcher::reload()
 {
-	std::map<std::string, std::string> configMap;
-	// check if file exists
-	std::ifstream f(cfgFile);
+	// a file which is being replaced keeps the current values
+	if (!fileIdentity(_cfgFile)) return 0;
 
-	// load config line by line
-	while (f.good())
+	ConfigCache values;
 	{
-		std::string line;
-		std::getline(f, line);
-		// remove quotation marks etc
-		std::erase(line, '\"');
-		std::erase(line, '\'');
-		const size_t pos = line.find(configDelimiter);
-		if (pos != std::string::npos)
-		{
-			auto token = line.substr(0, pos);
-			auto value = line.substr(pos + 1, line.size());
-			VarBase* var = findVarByLongName(token);
-			// also check rd
-			if (var && (var->isConfigRead() || var->isConfigReadWrite())) var->valueString(value);
-			configMap.insert({ std::move(token), std::move(value) });
-		}
+		const MappedFile file{ _cfgFile };
+		readConfigFile(_cfgFile, file, [&](const ConfigEntry& entry) {
+			values.insert_or_assign(std::string{ entry.token }, entry.value);
+		});
 	}
-	f.close();
-	return configMap;
+
+	// only changed entries are applied, the vars run their limits and callbacks as usual
+	size_t applied = 0;
+	for (const auto& [token, value] : values)
+	{
+		const auto it = _cache.find(token);
+		if (it != _cache.end() && it->second == value) continue;
+		applyConfigValue(ConfigEntry{ token, value, 0, 0, std::string_view::npos });
+		applied++;
+	}
+	// the values are new, the changes written with the cache are not
+	values.changeGeneration = _cache.changeGeneration;
+	_cache = std::move(values);
+	return applied;
 }
 
-void ccli::writeConfig(const std::string& cfgFile, ConfigCache& cache)
+ccli::MemoryStats ccli::memoryStats()
 {
-	const auto map = getLongNameVarMap();
-	bool write = false;
-	// update vars
-	for (const auto& [fst, snd] : map)
+	MemoryStats stats;
 	{
-		if (snd->isConfigReadWrite())
+		std::shared_lock lock{ getRegistryMutex() };
+		const auto& list = getVarList();
+		for (const VarListEntry& entry : list.entries)
 		{
-			// also check if rdwr
-			write |= doesConfigVarNeedUpdate(cache, fst, snd->valueString());
+			if (!entry.var) continue;
+			stats.varCount++;
+			stats.varBytes += entry.var->memoryUsage();
 		}
+		stats.registryBytes = getLongNameVarMap().memoryUsage() + getShortNameVarMap().memoryUsage()
+			+ list.entries.capacity() * sizeof(VarListEntry);
 	}
-	if (!write) return;
-	// create output string
-	std::stringstream outStream;
-	for (const auto& [fst, snd] : cache)
-	{
-		outStream << fst << configDelimiter;
-		outStream << '\"' << snd << "\"\n";
-	}
-	// write config
-	if (outStream.tellp()) writeConfigFile(cfgFile, outStream.str());
+	std::lock_guard lock{ getNameArenaMutex() };
+	const NameArena& arena = getNameArena();
+	stats.nameCount = arena.count();
+	stats.nameBytes = arena.stringBytes();
+	stats.nameArenaBytes = arena.reservedBytes();
+	return stats;
 }
 
-void ccli::writeConfig(const std::string& cfgFile)
+std::pmr::memory_resource* ccli::dynamicStorageResource() noexcept
 {
-	ConfigCache cache;
-	writeConfig(cfgFile, cache);
+	// every Dynamic var takes the pool when it is constructed, so it outlives static vars
+	static std::pmr::synchronized_pool_resource resource;
+	return &resource;
 }
 
 void ccli::executeCallbacks()
 {
-	for (const auto var : getCallbackSet())
+	// only run vars charged before this call, callbacks charging vars again are picked up by the next call
+	std::unique_lock lock{ getCallbackMutex() };
+	auto& queue = getCallbackQueue();
+	const uint64_t epoch = ++queue.epoch;
+	while (queue.head && queue.head->_queueEpoch < epoch)
 	{
+		VarBase* var = queue.head;
+		var->unlinkCallback();
+		// the destructor of the var dequeues it under the same lock and then waits for the pin
+		const VarPin pin{ *var };
+		lock.unlock();
 		var->executeCallback();
+		lock.lock();
 	}
 }
 
 ccli::IterationDecision ccli::forEachVar(const std::function<IterationDecision(VarBase&, size_t)>& callback)
 {
+	auto& list = getVarList();
+	// vars removed by the callback only leave tombstones, compaction waits until the outermost loop is done.
+	// No lock is held while the callback runs, so it may register or destroy vars.
+	{
+		std::unique_lock lock{ getRegistryMutex() };
+		list.iterating++;
+	}
+	struct IterationGuard {
+		VarList& list;
+		~IterationGuard()
+		{
+			std::unique_lock lock{ getRegistryMutex() };
+			if (--list.iterating == 0) compactVarList();
+		}
+	} guard{ list };
+
 	size_t idx = 0;
-	for (auto* varPtr : getVarList())
+	for (size_t i = 0;; i++)
 	{
+		VarBase* varPtr;
+		std::optional<VarPin> pin;
+		{
+			std::shared_lock lock{ getRegistryMutex() };
+			if (i >= list.entries.size()) break;
+			varPtr = list.entries[i].var;
+			// other threads may destroy the var while the callback runs, their destructor waits for the pin
+			if (varPtr) pin.emplace(*varPtr);
+		}
+		if (!varPtr) continue;
 		if (IterationDecision::Break == callback(*varPtr, idx++)) return IterationDecision::Break;
 	}
 	return IterationDecision::Continue;
 }
 
+void ccli::unregisterVars(const std::span<VarBase* const> vars)
+{
+	{
+		std::unique_lock lock{ getRegistryMutex() };
+		for (auto* var : vars)
+		{
+			if (var) var->unregister();
+		}
+		compactVarList();
+	}
+	for (auto* var : vars)
+	{
+		if (!var) continue;
+		var->dequeueCallback();
+		var->clearConfigDirty();
+	}
+}
+
 /*
 ** VarBase
 */
 ccli::VarBase::VarBase(const std::string_view shortName, const std::string_view longName, const uint32_t flags,
 	const std::string_view description, const bool hasCallback) :
-	_shortName{ shortName }, _longName{ longName },
-	_description{ description }, _flags{ flags }, _hasCallback{ hasCallback }
+	_shortName{ internName(shortName) }, _longName{ internName(longName) },
+	_description{ internName(description) }, _flags{ flags }, _hasCallback{ hasCallback },
+	_shortNameHash{ hashName(shortName) }, _longNameHash{ hashName(longName) }
 {
 	assert(!_longName.empty() || !_shortName.empty());
-	addToVarList(_longName, _shortName, this);
-	if (_hasCallback) addToCallbackSet(this);
 	/*if (_longName.empty() && (isConfigRead() || isConfigReadWrite())) {
 		getErrorDeque().emplace_back("Config requires long name \"\'-" + _shortName + "\'");
 	}*/
 }
 
+// the Var destructor already unregistered the var, this only matters if the constructor failed
 ccli::VarBase::~VarBase()
 {
-	removeFromVarList(_longName, _shortName, this);
-	if (_hasCallback) removeFromCallbackSet(this);
+	unregisterForDestruction();
 }
 
-const std::string& ccli::VarBase::longName() const noexcept
+void ccli::VarBase::registerVar()
+{
+	// a value loaded before the var existed is applied first, the check is repeated under the registry lock so a
+	// value loaded meanwhile is not lost
+	for (;;)
+	{
+		std::optional<std::string> value;
+		{
+			std::unique_lock lock{ getRegistryMutex() };
+			if (isConfigRead() || isConfigReadWrite()) value = takePendingConfig(_longName);
+			if (!value)
+			{
+				addToVarList(_longName, _longNameHash, _shortName, _shortNameHash, this, _registrySlot);
+				break;
+			}
+		}
+		// registration does not fail because of stale text in a config file, the value is dropped
+		try
+		{
+			valueString(*value);
+		}
+		catch (const ConversionError&)
+		{
+		}
+	}
+	// new vars are written by the next writeConfig, as if they had been changed
+	markConfigDirty();
+}
+
+void ccli::VarBase::unregisterForDestruction() noexcept
+{
+	{
+		std::unique_lock lock{ getRegistryMutex() };
+		unregister();
+		compactVarList();
+	}
+	dequeueCallback();
+	clearConfigDirty();
+	// nothing finds the var anymore, wait for the threads which still use it
+	VarPin::releaseOwn(*this);
+	while (_pins.load(std::memory_order_acquire)) std::this_thread::yield();
+}
+
+// requires the registry lock
+void ccli::VarBase::unregister()
+{
+	removeFromVarList(_longName, _longNameHash, _shortName, _shortNameHash, this, _registrySlot);
+}
+
+bool ccli::VarBase::isRegistered() const noexcept
+{
+	std::shared_lock lock{ getRegistryMutex() };
+	return _registrySlot != unregisteredSlot;
+}
+
+std::string_view ccli::VarBase::longName() const noexcept
 {
 	return _longName;
 }
 
-const std::string& ccli::VarBase::shortName() const noexcept
+std::string_view ccli::VarBase::shortName() const noexcept
 {
 	return _shortName;
 }
 
-const std::string& ccli::VarBase::description() const noexcept
+std::string_view ccli::VarBase::description() const noexcept
 {
 	return _description;
 }
 
+std::string ccli::VarBase::valueString() const
+{
+	std::array<char, 128> buffer;
+	const size_t length = formatValue(buffer);
+	if (length <= buffer.size()) return { buffer.data(), length };
+
+	std::string string(length, '\0');
+	formatValue(string);
+	return string;
+}
+
 void ccli::VarBase::valueString(std::string_view string)
 {
 	if (isReadOnly() || isCliOnly() || isLocked()) return;
 	setValueStringInternal(string);
 }
 
+void ccli::VarBase::chargeCallback() noexcept
+{
+	if (!_hasCallback) return;
+	_callbackCharged = true;
+	queueCallback();
+}
+
 bool ccli::VarBase::hasCallback() const noexcept
 {
 	return _hasCallback;
 }
 
+bool ccli::VarBase::isCallbackCharged() const noexcept
+{
+	return _callbackCharged;
+}
+
+void ccli::VarBase::doCallback()
+{
+	if (!_hasCallback) return;
+	if (isCallbackAutoExecuted())
+	{
+		_callbackCharged = true;
+		executeCallback();
+	}
+	else chargeCallback();
+}
+
+void ccli::VarBase::markConfigDirty()
+{
+	if (!isConfigReadWrite()) return;
+	std::unique_lock lock{ getDirtyMutex() };
+	auto& changes = getConfigChangeList();
+	unlinkConfigChange();
+	_prevChanged = changes.tail;
+	if (changes.tail) changes.tail->_nextChanged = this;
+	else changes.head = this;
+	changes.tail = this;
+	_changeGeneration = ++changes.generation;
+}
+
+void ccli::VarBase::clearConfigDirty() noexcept
+{
+	std::unique_lock lock{ getDirtyMutex() };
+	unlinkConfigChange();
+}
+
+// requires the dirty lock
+void ccli::VarBase::unlinkConfigChange() noexcept
+{
+	if (!_changeGeneration) return;
+	auto& changes = getConfigChangeList();
+	if (_prevChanged) _prevChanged->_nextChanged = _nextChanged;
+	else changes.head = _nextChanged;
+	if (_nextChanged) _nextChanged->_prevChanged = _prevChanged;
+	else changes.tail = _prevChanged;
+	_prevChanged = _nextChanged = nullptr;
+	_changeGeneration = 0;
+}
+
+std::vector<ccli::VarBase*> ccli::VarBase::configChangesSince(uint64_t& generation)
+{
+	std::vector<VarBase*> dirtyVars;
+	std::unique_lock lock{ getDirtyMutex() };
+	const auto& changes = getConfigChangeList();
+	for (VarBase* var = changes.tail; var && var->_changeGeneration > generation; var = var->_prevChanged)
+	{
+		// the caller holds the registry lock, isRegistered would lock it again
+		if (var->_registrySlot != unregisteredSlot) dirtyVars.push_back(var);
+	}
+	generation = changes.generation;
+	return dirtyVars;
+}
+
+void ccli::VarBase::queueCallback() noexcept
+{
+	// unregistered vars are not queued, the registry lock is held so the var cannot be unregistered meanwhile
+	std::shared_lock registryLock{ getRegistryMutex() };
+	if (_registrySlot == unregisteredSlot) return;
+	std::unique_lock lock{ getCallbackMutex() };
+	if (_callbackQueued) return;
+	auto& queue = getCallbackQueue();
+	_queueEpoch = queue.epoch;
+	_prevQueued = queue.tail;
+	_nextQueued = nullptr;
+	if (queue.tail) queue.tail->_nextQueued = this;
+	else queue.head = this;
+	queue.tail = this;
+	_callbackQueued = true;
+}
+
+void ccli::VarBase::dequeueCallback() noexcept
+{
+	std::unique_lock lock{ getCallbackMutex() };
+	unlinkCallback();
+}
+
+// requires the callback lock
+void ccli::VarBase::unlinkCallback() noexcept
+{
+	if (!_callbackQueued) return;
+	auto& queue = getCallbackQueue();
+	if (_prevQueued) _prevQueued->_nextQueued = _nextQueued;
+	else queue.head = _nextQueued;
+	if (_nextQueued) _nextQueued->_prevQueued = _prevQueued;
+	else queue.tail = _prevQueued;
+	_prevQueued = _nextQueued = nullptr;
+	_callbackQueued = false;
+}
+
 bool ccli::VarBase::isCliOnly() const noexcept
 {
 	return _flags & CliOnly;
@@ -480,80 +2586,180 @@ void ccli::VarBase::locked(const bool locked) noexcept
 size_t ccli::VarBase::setValueStringInternal(const std::string_view string, const size_t offset)
 {
 	if (isReadOnly() || isLocked()) return offset+ 1;
-	// empty string only allowed for bool and string
+	// empty string only allowed for bool and string, it clears Dynamic vars
 	if (string.empty()) {
-		if (!isBool() && !isString()) return offset+ 1;
+		if (!isBool() && !isString() && !isDynamic()) return offset+ 1;
+	}
+
+	const size_t next = setValueStringElements(string, offset);
+	applyLimitsAndDoCallback();
+
+	return next;
+}
+
+namespace
+{
+	struct NumberToken
+	{
+		std::string_view digits;
+		bool negative{ false };
+		int base{ 10 };
+	};
+
+	// spaces and tabs around a value token are ignored by all value parsers
+	std::string_view trimToken(std::string_view token) noexcept
+	{
+		while (!token.empty() && (token.front() == ' ' || token.front() == '\t')) token.remove_prefix(1);
+		while (!token.empty() && (token.back() == ' ' || token.back() == '\t')) token.remove_suffix(1);
+		return token;
 	}
 
-	const auto maxSize = size();
-	CSVParser csv{ string, _delimiter };
-	do
+	// splits surrounding whitespace, sign and base prefix off the token, std::from_chars handles the rest
+	NumberToken splitNumberToken(std::string_view token) noexcept
 	{
-		if (csv.count()+ offset >= maxSize) break;
+		NumberToken number;
+		token = trimToken(token);
+		if (!token.empty() && (token.front() == '-' || token.front() == '+'))
+		{
+			number.negative = token.front() == '-';
+			token.remove_prefix(1);
+		}
+		if (token.size() > 2 && token[0] == '0')
+		{
+			if (token[1] == 'x' || token[1] == 'X') number.base = 16;
+			else if (token[1] == 'b' || token[1] == 'B') number.base = 2;
+			if (number.base != 10) token.remove_prefix(2);
+		}
+		number.digits = token;
+		return number;
+	}
 
-		const auto token = csv.next();
-		setValueStringInternalAtIndex(csv.count() + offset - 1, token);
-	} while (csv.hasNext());
+	unsigned long long parseMagnitude(const ccli::VarBase& var, const std::string_view token, const NumberToken& number)
+	{
+		const char* const end = number.digits.data() + number.digits.size();
+		unsigned long long magnitude = 0;
+		// from_chars does not accept signs for unsigned types, so "--1" or "-+1" are rejected here
+		const auto [ptr, ec] = std::from_chars(number.digits.data(), end, magnitude, number.base);
+		if (ec != std::errc{} || ptr != end)
+		{
+			throw ccli::ConversionError{ var, std::string{ token } };
+		}
+		return magnitude;
+	}
 
-	applyLimitsAndDoCallback();
+	template <typename T>
+	T parseFloatingPoint(const ccli::VarBase& var, const std::string_view token)
+	{
+		const NumberToken number = splitNumberToken(token);
+		if (number.base == 2 || number.digits.empty() || number.digits.front() == '-' || number.digits.front() == '+')
+		{
+			throw ccli::ConversionError{ var, std::string{ token } };
+		}
 
-	return csv.count() + offset;
+		const char* const end = number.digits.data() + number.digits.size();
+		const auto format = number.base == 16 ? std::chars_format::hex : std::chars_format::general;
+		T value{};
+		const auto [ptr, ec] = std::from_chars(number.digits.data(), end, value, format);
+		if (ec != std::errc{} || ptr != end)
+		{
+			throw ccli::ConversionError{ var, std::string{ token } };
+		}
+		return number.negative ? -value : value;
+	}
 }
 
-//template <typename T>
-//T parseUsingFromChars(const ccli::VarBase& var, std::string_view token)
-//{
-//	T value;
-//	auto result = std::from_chars(token.data(), token.data() + token.size(), value);
-//	if (result.ec == std::errc::invalid_argument)
-//	{
-//		throw ccli::ConversionError{ var, std::string{ token } };
-//	}
-//	return value;
-//}
+long long ccli::VarBase::parseIntegral(const ccli::VarBase& var, const std::string_view token, const long long min, const long long max)
+{
+	const NumberToken number = splitNumberToken(token);
+	const unsigned long long magnitude = parseMagnitude(var, token, number);
+	if (number.negative)
+	{
+		// magnitude of min computed without overflowing
+		const unsigned long long minMagnitude = min < 0 ? static_cast<unsigned long long>(-(min + 1)) + 1 : 0;
+		if (magnitude > minMagnitude) throw ccli::ConversionError{ var, std::string{ token } };
+		return magnitude == 0 ? 0 : -static_cast<long long>(magnitude - 1) - 1;
+	}
+	if (magnitude > static_cast<unsigned long long>(max)) throw ccli::ConversionError{ var, std::string{ token } };
+	return static_cast<long long>(magnitude);
+}
 
-long long ccli::VarBase::parseIntegral(const ccli::VarBase& var, const std::string_view token)
+unsigned long long ccli::VarBase::parseUnsigned(const ccli::VarBase& var, const std::string_view token, const unsigned long long max)
 {
-	// return parseUsingFromChars<long long>(var, token);
-	char* end;
-	const long long v = std::strtoll(token.data(), &end, 10);
-	if (end != token.data() + token.size())
+	const NumberToken number = splitNumberToken(token);
+	const unsigned long long magnitude = parseMagnitude(var, token, number);
+	if (magnitude > max || (number.negative && magnitude != 0))
 	{
 		throw ccli::ConversionError{ var, std::string{ token } };
 	}
-	return v;
+	return magnitude;
 }
 
 double ccli::VarBase::parseDouble(const ccli::VarBase& var, const std::string_view token)
 {
-	// return parseUsingFromChars<double>(var, token);
-	char* end;
-	const double v = std::strtod(token.data(), &end);
-	if (end != token.data() + token.size())
+	return parseFloatingPoint<double>(var, token);
+}
+
+float ccli::VarBase::parseFloat(const ccli::VarBase& var, const std::string_view token)
+{
+	return parseFloatingPoint<float>(var, token);
+}
+
+namespace
+{
+	// packs up to 8 characters into one word, so a token can be matched with a single comparison
+	constexpr uint64_t packWord(const std::string_view word) noexcept
 	{
-		throw ccli::ConversionError{ var, std::string{ token } };
+		uint64_t packed = 0;
+		for (size_t i = 0; i < word.size(); i++) packed |= static_cast<uint64_t>(static_cast<unsigned char>(word[i])) << (i * 8);
+		return packed;
 	}
-	return v;
+
+	struct BoolWord
+	{
+		uint64_t packed;
+		bool value;
+	};
+
+	constexpr BoolWord boolWords[] = {
+		{ packWord("true"), true }, { packWord("false"), false },
+		{ packWord("1"), true }, { packWord("0"), false },
+		{ packWord("yes"), true }, { packWord("no"), false },
+		{ packWord("on"), true }, { packWord("off"), false },
+	};
+	constexpr size_t maxBoolWordLength = 5;
 }
 
-bool ccli::VarBase::parseBool(const std::string_view token)
+std::optional<bool> ccli::VarBase::tryParseBool(std::string_view token) noexcept
 {
-	if (token.empty())
+	// only a missing value means true, a value made of whitespace is rejected like it is for numbers
+	if (token.empty()) return true;
+	token = trimToken(token);
+	if (token.empty() || token.size() > maxBoolWordLength) return {};
+
+	// lower case only 'A'-'Z', other characters must not alias letters
+	uint64_t packed = 0;
+	for (size_t i = 0; i < token.size(); i++)
 	{
-		return true;
+		const auto c = static_cast<unsigned char>(token[i]);
+		const auto lower = static_cast<unsigned char>(c | (static_cast<unsigned>(c - 'A') < 26u) << 5);
+		packed |= static_cast<uint64_t>(lower) << (i * 8);
 	}
 
-	bool value;
-	const std::string copiedToken{ token };
-
-	std::istringstream{ copiedToken } >> std::boolalpha >> value;
-	if (value)
+	for (const auto& [word, value] : boolWords)
 	{
-		return true;
+		if (word == packed) return value;
 	}
+	return {};
+}
 
-	std::istringstream{ copiedToken } >> value;
-	return value;
+bool ccli::VarBase::parseBool(const ccli::VarBase& var, const std::string_view token)
+{
+	const auto value = tryParseBool(token);
+	if (!value)
+	{
+		throw ccli::ConversionError{ var, std::string{ token } };
+	}
+	return *value;
 }
 
 namespace {
@@ -608,13 +2814,16 @@ void ccli::DuplicatedVarNameError::throwSelf() const
 	throw* this;
 }
 
-ccli::FileError::FileError(std::string path)
-	: CCLIError{ {}, std::move(path) } {}
+ccli::FileError::FileError(std::string path, const Kind kind)
+	: CCLIError{ {}, std::move(path) }, _kind{ kind } {}
 
 std::string_view ccli::FileError::message() const
 {
 	if (_message.empty()) {
-		_message = buildString("Could not open file '"sv, _arg, "' for writing. Could not save varibles to disk."sv);
+		if (_kind == Kind::ResponseFile) {
+			_message = buildString("Could not read response file '"sv, _arg, "'. It does not exist or is nested too deeply."sv);
+		}
+		else _message = buildString("Could not open file '"sv, _arg, "' for writing. Could not save varibles to disk."sv);
 	}
 
 	return _message;
@@ -642,6 +2851,23 @@ void ccli::UnknownArgError::throwSelf() const
 	throw* this;
 }
 
+ccli::AmbiguousArgError::AmbiguousArgError(std::string name)
+	: CCLIError{ {}, std::move(name) } {}
+
+std::string_view ccli::AmbiguousArgError::message() const
+{
+	if (_message.empty()) {
+		_message = buildString("Input '"sv, _arg, "' matches more than one variable. None of them was set."sv);
+	}
+
+	return _message;
+}
+
+void ccli::AmbiguousArgError::throwSelf() const
+{
+	throw* this;
+}
+
 ccli::MissingValueError::MissingValueError(std::string name)
 	: CCLIError{ {}, std::move(name) } {}
 
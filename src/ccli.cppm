@@ -4,12 +4,27 @@ export module ccli;
 
 export namespace ccli {
 	using ccli::parseArgs;
+	using ccli::parseLine;
+	using ccli::parseLines;
+	using ccli::parseEnv;
+	using ccli::ParseContext;
 	using ccli::loadConfig;
+	using ccli::loadConfigLayers;
+	using ccli::applyConfig;
+	using ccli::applyConfigCached;
 	using ccli::writeConfig;
+	using ccli::writeConfigAsync;
+	using ccli::flushConfig;
 	using ccli::executeCallbacks;
 	using ccli::forEachVar;
+	using ccli::unregisterVars;
+	using ccli::dynamicStorageResource;
+	using ccli::memoryStats;
 
 	using ccli::ConfigCache;
+	using ccli::MemoryStats;
+	using ccli::LayeredConfig;
+	using ccli::ConfigWatcher;
 	using ccli::IterationDecision;
 	using ccli::VarBase;
 	using ccli::Var;
@@ -18,11 +33,14 @@ export namespace ccli {
 	using ccli::Storage;
 	using ccli::MinLimit;
 	using ccli::MaxLimit;
+	using ccli::Atomic;
+	using ccli::Dynamic;
 
 	using ccli::CCLIError;
 	using ccli::DuplicatedVarNameError;
 	using ccli::FileError;
 	using ccli::UnknownArgError;
+	using ccli::AmbiguousArgError;
 	using ccli::MissingValueError;
 	using ccli::ConversionError;
 }
\ No newline at end of file
@@ -5,9 +5,18 @@
 #include <sstream>
 #include <fstream>
 #include <cstring>
+#include <cstdlib>
 #include <limits>
 #include <algorithm>
 #include <span>
+#include <memory>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <filesystem>
+#include <chrono>
+#include <future>
+#include <iterator>
 #include <ccli/ccli.h>
 //import ccli;
 
@@ -169,6 +178,149 @@ namespace
 		assert(value2 == 0.0f);
 	}
 
+	void contextCallbackTest() {
+		struct Counter { int calls{ 0 }; int last{ 0 }; } counter;
+		const auto record = [](void* context, const int& v) {
+			auto* c = static_cast<Counter*>(context);
+			c->calls++;
+			c->last = v;
+		};
+		ccli::Var<int> fnVar("fnCallback"sv, ""sv, 0, ccli::None, ""sv, record, &counter);
+		assert(fnVar.hasCallback());
+		fnVar.valueString("5"sv);
+		assert(counter.calls == 1 && counter.last == 5);
+
+		ccli::Var<int, 2> fnArrayVar("fnArrayCallback"sv, ""sv, { 0, 0 }, ccli::ManualExec, ""sv,
+			[](void* context, std::span<const int> v) { static_cast<Counter*>(context)->last = v[0] + v[1]; }, &counter);
+		counter.last = 0;
+		fnArrayVar.valueString("2,3"sv);
+		assert(counter.last == 0);
+		ccli::executeCallbacks();
+		assert(counter.last == 5);
+		fnArrayVar.valueString("4,3"sv);
+		assert(fnArrayVar.executeCallback() && counter.last == 7);
+	}
+
+	void memoryStatsTest() {
+		const ccli::MemoryStats before = ccli::memoryStats();
+		{
+			std::vector<std::unique_ptr<ccli::Var<int>>> vars;
+			for (int i = 0; i < 100; i++)
+			{
+				vars.push_back(std::make_unique<ccli::Var<int>>(""sv, "memoryStatsVar" + std::to_string(i), i, ccli::None,
+					"shared description"sv));
+			}
+			// equal descriptions are interned once
+			assert(vars[0]->description().data() == vars[99]->description().data());
+
+			const ccli::MemoryStats stats = ccli::memoryStats();
+			assert(stats.varCount == before.varCount + 100);
+			assert(stats.varBytes >= before.varBytes + 100 * sizeof(ccli::Var<int>));
+			assert(stats.nameCount >= before.nameCount + 100);
+			assert(stats.nameBytes > before.nameBytes + 100 * "memoryStatsVar"sv.size());
+			assert(stats.nameArenaBytes >= stats.nameBytes && stats.registryBytes > 0);
+		}
+
+		// the names stay interned, recreating the vars does not grow the arena
+		const ccli::MemoryStats after = ccli::memoryStats();
+		assert(after.varCount == before.varCount);
+		ccli::Var<int> again(""sv, "memoryStatsVar0"sv, 0, ccli::None, "shared description"sv);
+		assert(ccli::memoryStats().nameBytes == after.nameBytes);
+	}
+
+	void callbackQueueTest() {
+		std::vector<int> order;
+		auto record = [&](const int v) { order.push_back(v); };
+		ccli::Var<int> a("qa"sv, ""sv, 0, ccli::ManualExec, ""sv, record);
+		ccli::Var<int> b("qb"sv, ""sv, 0, ccli::ManualExec, ""sv, record);
+		auto c = std::make_unique<ccli::Var<int>>("qc"sv, ""sv, 0, ccli::ManualExec, ""sv, record);
+
+		// callbacks run in charge order, each var once
+		b.value(2);
+		c->value(3);
+		a.value(1);
+		b.value(4);
+		assert(b.isCallbackCharged());
+		ccli::executeCallbacks();
+		assert((order == std::vector<int>{ 4, 3, 1 }));
+		assert(!b.isCallbackCharged());
+
+		// destroyed vars leave the queue
+		order.clear();
+		c->value(5);
+		a.value(6);
+		c.reset();
+		ccli::executeCallbacks();
+		assert((order == std::vector<int>{ 6 }));
+
+		// vars charged by a callback run in the next call
+		order.clear();
+		ccli::Var<int> d("qd"sv, ""sv, 0, ccli::ManualExec, ""sv, [&](const int v) {
+			order.push_back(v);
+			a.value(v + 1);
+		});
+		d.value(10);
+		ccli::executeCallbacks();
+		assert((order == std::vector<int>{ 10 }));
+		ccli::executeCallbacks();
+		assert((order == std::vector<int>{ 10, 11 }));
+		ccli::executeCallbacks();
+		assert(order.size() == 2);
+	}
+
+	void atomicVarTest() {
+		ccli::Var<int, 1, ccli::Atomic> intVar("atomicInt"sv, ""sv, 0);
+		ccli::Var<float, 4, ccli::MaxLimit<500>, ccli::Atomic> vecVar("atomicVec"sv, ""sv, { 0.0f, 0.0f, 0.0f, 0.0f });
+		ccli::Var<std::string, 1, ccli::Atomic> stringVar("atomicString"sv, ""sv, "");
+		static_assert(std::is_same_v<decltype(intVar.value()), int>);
+		static_assert(std::is_same_v<decltype(vecVar.value()), std::shared_ptr<const std::array<float, 4>>>);
+		static_assert(std::is_same_v<decltype(stringVar.value()), std::shared_ptr<const std::string>>);
+
+		// readers must always see complete values while another thread writes
+		std::atomic<bool> done{ false };
+		std::thread reader([&] {
+			while (!done.load())
+			{
+				const int i = intVar;
+				assert(i >= 0 && i < 1000);
+				const auto vec = vecVar.value();
+				assert((*vec)[0] == (*vec)[1] && (*vec)[1] == (*vec)[2] && (*vec)[2] == (*vec)[3] && (*vec)[0] <= 500.0f);
+				const auto string = stringVar.value();
+				assert(string->find_first_not_of(string->empty() ? ' ' : string->front()) == std::string::npos);
+				const std::string copy = stringVar;
+				assert(copy.find_first_not_of(copy.empty() ? ' ' : copy.front()) == std::string::npos);
+				assert(vecVar.size() == 4 && vecVar[0] <= 500.0f);
+			}
+		});
+
+		for (int i = 0; i < 1000; i++)
+		{
+			intVar.value(i);
+			const std::string element = std::to_string(i);
+			vecVar.valueString(element + "," + element + "," + element + "," + element);
+			stringVar.value(std::string(static_cast<size_t>(i % 20), static_cast<char>('a' + i % 26)));
+		}
+		done = true;
+		reader.join();
+
+		assert(intVar == 999);
+		assert(vecVar[0] == 500.0f);
+		assert(vecVar.valueString() == "500,500,500,500");
+
+		// a copy held by a reader stays valid, replaced copies are freed by their last reader
+		ccli::Var<float, 1024, ccli::Atomic> bigVar(""sv, "atomicBig"sv, {});
+		const size_t idle = ccli::memoryStats().varBytes;
+		const auto held = bigVar.value();
+		for (int i = 1; i <= 10; i++) bigVar.value({ static_cast<float>(i) });
+		assert(ccli::memoryStats().varBytes == idle);
+		assert((*held)[0] == 0.0f && bigVar[0] == 10.0f);
+
+		ccli::Var<int, ccli::Dynamic, ccli::Atomic> listVar(""sv, "atomicList"sv, { 1, 2 });
+		const auto list = listVar.value();
+		listVar.valueString("3,4,5");
+		assert(list->size() == 2 && listVar.size() == 3 && listVar[2] == 5);
+	}
+
 	void exceptionTest() {
 		try {
 			throw ccli::FileError{ "a/file/name" };
@@ -357,6 +509,510 @@ namespace
 		}
 	}
 
+	void configDirtyTest()
+	{
+		static constexpr auto filename = "configDirtyTest.ini";
+		ccli::ConfigCache cache;
+		ccli::writeConfig(filename, cache);
+		remove(filename);
+
+		ccli::Var<int> dirtyVar(""sv, "dirty"sv, 1, ccli::ConfigRdwr);
+		ccli::Var<int> otherVar(""sv, "other"sv, 2, ccli::ConfigRdwr);
+
+		// new vars are written once
+		ccli::writeConfig(filename, cache);
+		assert(std::filesystem::exists(filename));
+		assert(cache.at("dirty") == "1" && cache.at("other") == "2");
+		remove(filename);
+		ccli::writeConfig(filename, cache);
+		assert(!std::filesystem::exists(filename));
+
+		// setting the same value marks the var dirty, but the file is only written if the cache changed
+		dirtyVar.value(1);
+		ccli::writeConfig(filename, cache);
+		assert(!std::filesystem::exists(filename));
+
+		dirtyVar.value(3);
+		ccli::writeConfig(filename, cache);
+		assert(cache.at("dirty") == "3");
+		{
+			std::stringstream cfgfile;
+			cfgfile << std::ifstream(filename).rdbuf();
+			assert(cfgfile.view() == "dirty=\"3\"\nother=\"2\"\n");
+		}
+
+		// destroyed vars are dropped from the dirty list
+		{
+			ccli::Var<int> tempVar(""sv, "temp"sv, 4, ccli::ConfigRdwr);
+		}
+		remove(filename);
+		ccli::writeConfig(filename, cache);
+		assert(!std::filesystem::exists(filename));
+
+		// every cache sees the changes on its own, writing one file does not hide them from another
+		static constexpr auto otherFilename = "configDirtyTestOther.ini";
+		ccli::ConfigCache otherCache;
+		ccli::writeConfig(otherFilename, otherCache);
+		assert(otherCache.at("dirty") == "3" && otherCache.at("other") == "2");
+		otherVar.value(5);
+		ccli::writeConfig(filename, cache);
+		ccli::writeConfig(otherFilename, otherCache);
+		assert(cache.at("other") == "5" && otherCache.at("other") == "5");
+		{
+			std::stringstream cfgfile;
+			cfgfile << std::ifstream(otherFilename).rdbuf();
+			assert(cfgfile.view() == "dirty=\"3\"\nother=\"5\"\n");
+		}
+		remove(filename);
+		remove(otherFilename);
+	}
+
+	void configRewriteTest()
+	{
+		static constexpr auto filename = "configRewriteTest.ini";
+		{
+			std::ofstream cfgfile(filename);
+			cfgfile << "# settings\nwidth=\"100\"\nname=\"abc\"\nwidth=\"200\"\nunknown=\"1\"";
+		}
+		ccli::Var<int> widthVar(""sv, "width"sv, 0, ccli::ConfigRdwr);
+		ccli::Var<std::string> nameVar(""sv, "name"sv, "", ccli::ConfigRdwr);
+		ccli::ConfigCache cache = ccli::loadConfig(filename);
+		assert(widthVar.value() == 200 && cache.at("width") == "200");
+		assert(nameVar.value() == "abc");
+
+		const auto readFile = [] {
+			std::stringstream cfgfile;
+			cfgfile << std::ifstream(filename).rdbuf();
+			return cfgfile.str();
+		};
+
+		// same length values are overwritten in place
+		widthVar.value(300);
+		ccli::writeConfig(filename, cache);
+		assert(readFile() == "# settings\nwidth=\"100\"\nname=\"abc\"\nwidth=\"300\"\nunknown=\"1\"");
+
+		// other changes are appended
+		nameVar.value("abcdef");
+		ccli::writeConfig(filename, cache);
+		assert(readFile() == "# settings\nwidth=\"100\"\nname=\"abc\"\nwidth=\"300\"\nunknown=\"1\"\nname=\"abcdef\"\n");
+		nameVar.value("ghijkl");
+		ccli::writeConfig(filename, cache);
+		assert(readFile() == "# settings\nwidth=\"100\"\nname=\"abc\"\nwidth=\"300\"\nunknown=\"1\"\nname=\"ghijkl\"\n");
+
+		// the file is reloaded with the latest values
+		widthVar.value(0);
+		nameVar.value("");
+		assert(ccli::loadConfig(filename) == cache);
+		assert(widthVar.value() == 300 && nameVar.value() == "ghijkl");
+
+		// external changes are not patched, the file is rewritten keeping comments and dropping superseded entries
+		{
+			std::ofstream cfgfile(filename, std::ios::app);
+			cfgfile << "# external\n";
+		}
+		widthVar.value(4);
+		ccli::writeConfig(filename, cache);
+		assert(readFile() == "# settings\nwidth=\"4\"\nname=\"ghijkl\"\nunknown=\"1\"\n# external\n");
+
+		// once the superseded entries make up most of the file it is compacted
+		for (size_t i = 1; i < 30; i++)
+		{
+			nameVar.value(std::string(i, 'x'));
+			ccli::writeConfig(filename, cache);
+		}
+		assert(ccli::loadConfig(filename) == cache);
+		assert(readFile().size() < 200);
+
+		// an append cut short by a crash lacks the line break, the loader keeps the previous value
+		for (const auto* torn : { "name=", "name=\"", "name=\"to" })
+		{
+			std::ofstream(filename, std::ios::app) << torn;
+			ccli::loadConfig(filename);
+			assert(nameVar.value() == std::string(29, 'x'));
+			ccli::writeConfig(filename);
+		}
+		std::ofstream(filename, std::ios::app) << "name=\"complete\"";
+		ccli::loadConfig(filename);
+		assert(nameVar.value() == "complete");
+
+		// quotes inside values are escaped, a line cut short right behind one is not taken for a complete value
+		nameVar.value("a\"b");
+		ccli::writeConfig(filename);
+		assert(readFile().find("name=\"a\\\"b\"\n") != std::string::npos);
+		cache = ccli::loadConfig(filename);
+		assert(nameVar.value() == "a\"b" && cache.at("name") == "a\"b");
+		// an escaped value is appended, a later value of the same length must not be patched over it
+		nameVar.value("c\"d");
+		ccli::writeConfig(filename, cache);
+		nameVar.value("efg");
+		ccli::writeConfig(filename, cache);
+		nameVar.value("");
+		ccli::loadConfig(filename);
+		assert(nameVar.value() == "efg");
+		std::ofstream(filename, std::ios::app) << "name=\"x\\\"";
+		ccli::loadConfig(filename);
+		assert(nameVar.value() == "efg");
+		remove(filename);
+	}
+
+	void configAsyncTest()
+	{
+		static constexpr auto filename = "configAsyncTest.ini";
+		ccli::Var<int> asyncVar(""sv, "async"sv, 1, ccli::ConfigRdwr);
+		ccli::Var<std::string> otherVar(""sv, "asyncOther"sv, "a", ccli::ConfigRdwr);
+		const auto readFile = [] {
+			std::stringstream cfgfile;
+			cfgfile << std::ifstream(filename).rdbuf();
+			return cfgfile.str();
+		};
+
+		ccli::writeConfigAsync(filename).get();
+		assert(readFile() == "async=\"1\"\nasyncOther=\"a\"\n");
+		for (const auto& entry : std::filesystem::directory_iterator{ "." })
+		{
+			assert(entry.path().extension() != ".tmp");
+		}
+
+		// values are taken when the write is requested, pending writes of a file are merged
+		ccli::ConfigCache cache = ccli::loadConfig(filename);
+		asyncVar.value(2);
+		const auto first = ccli::writeConfigAsync(filename, cache);
+		otherVar.value("b");
+		const auto second = ccli::writeConfigAsync(filename, cache);
+		asyncVar.value(3);
+		ccli::flushConfig();
+		assert(first.wait_for(std::chrono::seconds(0)) == std::future_status::ready);
+		assert(second.wait_for(std::chrono::seconds(0)) == std::future_status::ready);
+		assert(readFile() == "async=\"2\"\nasyncOther=\"b\"\n");
+		assert(cache.at("async") == "2" && cache.at("asyncOther") == "b");
+
+		// changes after the request are written by the next one
+		ccli::writeConfigAsync(filename, cache).get();
+		assert(readFile() == "async=\"3\"\nasyncOther=\"b\"\n");
+		// nothing changed, a ready future is returned
+		assert(ccli::writeConfigAsync(filename, cache).wait_for(std::chrono::seconds(0)) == std::future_status::ready);
+
+		// errors are passed on by the future
+		bool caught = false;
+		try
+		{
+			ccli::writeConfigAsync("missingDirectory/configAsyncTest.ini").get();
+		}
+		catch (const ccli::FileError&)
+		{
+			caught = true;
+		}
+		assert(caught);
+		remove(filename);
+	}
+
+	void configBinaryCacheTest()
+	{
+		static constexpr auto filename = "configBinaryCacheTest.ini";
+		static constexpr auto binaryFilename = "configBinaryCacheTest.ini.bin";
+		{
+			std::ofstream cfgfile(filename);
+			cfgfile << "int=\"5\"\nfloats=\"1.5,2.5\"\nstrings=\"a,,c\"\nflag=\"off\"\nlimited=\"500\"\n"
+				"\"quoted\"=\"x\"\nunknown=\"1\"\nint=\"7\"\n";
+		}
+		remove(binaryFilename);
+
+		size_t callbacks = 0;
+		auto intVar = std::make_unique<ccli::Var<int>>(""sv, "int"sv, 0, ccli::ConfigRead);
+		ccli::Var<float, 3> floatVar(""sv, "floats"sv, { 0.0f, 0.0f, 9.0f }, ccli::ConfigRead);
+		ccli::Var<std::string, 3> stringVar(""sv, "strings"sv, { "", "", "" }, ccli::ConfigRead);
+		ccli::Var<bool> flagVar(""sv, "flag"sv, true, ccli::ConfigRead);
+		ccli::Var<int, 1, ccli::MaxLimit<100>> limitedVar(""sv, "limited"sv, 0, ccli::ConfigRead, ""sv,
+			[&](int) { callbacks++; });
+		ccli::Var<std::string> quotedVar(""sv, "quoted"sv, "", ccli::ConfigRead);
+
+		const auto check = [&] {
+			assert(intVar->value() == 7);
+			assert(floatVar[0] == 1.5f && floatVar[1] == 2.5f && floatVar[2] == 9.0f);
+			assert(stringVar[0] == "a" && stringVar[1].empty() && stringVar[2] == "c");
+			assert(!flagVar.value());
+			assert(limitedVar.value() == 100);
+			assert(quotedVar.value() == "x");
+		};
+		const auto reset = [&] {
+			intVar->value(0);
+			floatVar.value({ 0.0f, 0.0f, 9.0f });
+			stringVar.value({ "", "", "" });
+			flagVar.value(true);
+			limitedVar.value(0);
+			quotedVar.value("");
+			callbacks = 0;
+		};
+
+		// the first run parses the text and writes the cache, the second one only reads the cache
+		ccli::applyConfigCached(filename);
+		check();
+		assert(callbacks == 1);
+		assert(std::filesystem::exists(binaryFilename));
+		const auto cacheTime = std::filesystem::last_write_time(binaryFilename);
+		reset();
+		ccli::applyConfigCached(filename);
+		check();
+		assert(callbacks == 1);
+		assert(std::filesystem::last_write_time(binaryFilename) == cacheTime);
+
+		// data which does not fit a var is found before any cached value is applied, the text is parsed instead.
+		// The payload hash is recomputed the way the cache writer does, so only the string lengths are wrong.
+		{
+			std::string content;
+			{
+				std::ifstream binary(binaryFilename, std::ios::binary);
+				content.assign(std::istreambuf_iterator<char>{ binary }, {});
+			}
+			constexpr size_t headerSize = 48;
+			const size_t data = content.find("strings", headerSize) + "strings"sv.size();
+			const uint32_t length = 200;
+			std::memcpy(content.data() + data, &length, sizeof(length));
+			const std::string_view payload = std::string_view{ content }.substr(headerSize);
+			uint64_t hash = 0xcbf29ce484222325ull ^ payload.size();
+			size_t i = 0;
+			for (; i + sizeof(uint64_t) <= payload.size(); i += sizeof(uint64_t))
+			{
+				uint64_t word;
+				std::memcpy(&word, payload.data() + i, sizeof(word));
+				hash = (hash ^ word) * 0x9e3779b97f4a7c15ull;
+				hash ^= hash >> 29;
+			}
+			for (; i < payload.size(); i++) hash = (hash ^ static_cast<unsigned char>(payload[i])) * 0x100000001b3ull;
+			hash ^= hash >> 32;
+			std::memcpy(content.data() + headerSize - sizeof(hash), &hash, sizeof(hash));
+			std::ofstream binary(binaryFilename, std::ios::binary | std::ios::trunc);
+			binary << content;
+		}
+		reset();
+		ccli::applyConfigCached(filename);
+		check();
+		assert(callbacks == 1);
+
+		// a changed var type is detected and the text is parsed again
+		intVar.reset();
+		ccli::Var<double> doubleVar(""sv, "int"sv, 0.0, ccli::ConfigRead);
+		ccli::applyConfigCached(filename);
+		assert(doubleVar.value() == 7.0);
+
+		// a damaged cache is ignored
+		{
+			std::fstream binary(binaryFilename, std::ios::in | std::ios::out | std::ios::binary);
+			binary.seekp(-1, std::ios::end);
+			binary.put('x');
+		}
+		doubleVar.value(0.0);
+		ccli::applyConfigCached(filename);
+		assert(doubleVar.value() == 7.0);
+
+		// a changed text file replaces the cache
+		{
+			std::ofstream cfgfile(filename, std::ios::app);
+			cfgfile << "int=\"8\"\n";
+		}
+		ccli::applyConfigCached(filename);
+		assert(doubleVar.value() == 8.0);
+		doubleVar.value(0.0);
+		ccli::applyConfigCached(filename);
+		assert(doubleVar.value() == 8.0);
+
+		remove(filename);
+		remove(binaryFilename);
+
+		// the cache follows the same rules as applyConfig for vars which config files cannot change
+		{
+			std::ofstream cfgfile(filename);
+			cfgfile << "cachedCliOnly=\"1\"\ncachedReadOnly=\"1\"\ncachedLocked=\"1\"\n";
+		}
+		ccli::Var<int> cliOnlyVar(""sv, "cachedCliOnly"sv, 0, ccli::CliOnly | ccli::ConfigRead);
+		ccli::Var<int> readOnlyVar(""sv, "cachedReadOnly"sv, 0, ccli::ReadOnly | ccli::ConfigRead);
+		ccli::Var<int> lockedVar(""sv, "cachedLocked"sv, 0, ccli::Locked | ccli::ConfigRead);
+		for (int run = 0; run < 2; run++)
+		{
+			const char* argv[] = { "--cachedCliOnly", "9" };
+			ccli::parseArgs(std::size(argv), argv);
+			ccli::applyConfigCached(filename);
+			assert(cliOnlyVar.value() == 9);
+			assert(readOnlyVar.value() == 0);
+			assert(lockedVar.value() == 0);
+		}
+		// the values of the text are cached, not the values the vars had while the cache was written
+		lockedVar.unlock();
+		ccli::applyConfigCached(filename);
+		assert(lockedVar.value() == 1);
+
+		remove(filename);
+		remove(binaryFilename);
+	}
+
+	void pendingConfigTest()
+	{
+		static constexpr auto filename = "pendingConfigTest.ini";
+		{
+			std::ofstream cfgfile(filename);
+			cfgfile << "lateVar=\"42\"\nlateArray=\"1,2\"\nlateNoConfig=\"3\"\nlateVar=\"43\"\n";
+		}
+		const ccli::ConfigCache cache = ccli::loadConfig(filename);
+		remove(filename);
+		assert(cache.at("lateVar") == "43");
+
+		// vars registered after loading pick up their value once
+		int callbackValue = 0;
+		{
+			ccli::Var<int> lateVar(""sv, "lateVar"sv, 0, ccli::ConfigRead, ""sv, [&](const int v) { callbackValue = v; });
+			assert(lateVar.value() == 43 && callbackValue == 43);
+		}
+		{
+			ccli::Var<int> lateVar(""sv, "lateVar"sv, 0, ccli::ConfigRead);
+			assert(lateVar.value() == 0);
+		}
+		ccli::Var<int, 3> lateArray(""sv, "lateArray"sv, { 0, 0, 5 }, ccli::ConfigRdwr);
+		assert(lateArray[0] == 1 && lateArray[1] == 2 && lateArray[2] == 5);
+
+		// vars which do not read the config leave the value for later
+		{
+			ccli::Var<int> lateNoConfig(""sv, "lateNoConfig"sv, 0);
+			assert(lateNoConfig.value() == 0);
+		}
+		ccli::Var<int> lateNoConfig(""sv, "lateNoConfig"sv, 0, ccli::ConfigRead);
+		assert(lateNoConfig.value() == 3);
+
+		// loading a value for an existing var drops an older pending value of the same name
+		{
+			std::ofstream cfgfile(filename);
+			cfgfile << "lateOther=\"1\"\n";
+		}
+		ccli::applyConfig(filename);
+		{
+			ccli::Var<int> lateOther(""sv, "lateOther"sv, 0);
+			ccli::applyConfig(filename);
+		}
+		ccli::Var<int> lateOther(""sv, "lateOther"sv, 0, ccli::ConfigRead);
+		assert(lateOther.value() == 0);
+
+		// a pending value which does not convert is dropped instead of failing the registration
+		{
+			std::ofstream cfgfile(filename);
+			cfgfile << "lateBad=\"abc\"\n";
+		}
+		ccli::applyConfig(filename);
+		{
+			ccli::Var<int> lateBad(""sv, "lateBad"sv, 7, ccli::ConfigRead);
+			assert(lateBad.value() == 7);
+		}
+		ccli::Var<int> lateBad(""sv, "lateBad"sv, 8, ccli::ConfigRead);
+		assert(lateBad.value() == 8);
+		remove(filename);
+	}
+
+	void configLayersTest()
+	{
+		const std::vector<std::string> files{ "configLayersDefaults.ini", "configLayersSite.ini", "configLayersUser.ini" };
+		{
+			std::ofstream(files[0]) << "layerA=\"1\"\nlayerB=\"1\"\nlayerC=\"1\"\n";
+			std::ofstream(files[1]) << "# site\nlayerB=\"2\"\nlayerC=\"2\"\n";
+			std::ofstream(files[2]) << "layerC=\"3\"\n";
+		}
+		const auto readFile = [](const std::string& filename) {
+			std::stringstream cfgfile;
+			cfgfile << std::ifstream(filename).rdbuf();
+			return cfgfile.str();
+		};
+
+		// later layers win and every var is set once
+		size_t callbacks = 0;
+		ccli::Var<int> varA(""sv, "layerA"sv, 0, ccli::ConfigRdwr);
+		ccli::Var<int> varB(""sv, "layerB"sv, 0, ccli::ConfigRdwr);
+		ccli::Var<int> varC(""sv, "layerC"sv, 0, ccli::ConfigRdwr, ""sv, [&](int) { callbacks++; });
+		ccli::Var<int> varD(""sv, "layerD"sv, 4, ccli::ConfigRdwr);
+		ccli::LayeredConfig config = ccli::loadConfigLayers(files);
+		assert(varA.value() == 1 && varB.value() == 2 && varC.value() == 3);
+		assert(callbacks == 1);
+		assert(config.origins.at("layerA") == 0 && config.origins.at("layerB") == 1 && config.origins.at("layerC") == 2);
+
+		// changes go back to the layer the value came from, new values to the last one
+		varA.value(5);
+		varB.value(6);
+		ccli::writeConfig(config);
+		assert(readFile(files[0]) == "layerA=\"5\"\nlayerB=\"1\"\nlayerC=\"1\"\n");
+		assert(readFile(files[1]) == "# site\nlayerB=\"6\"\nlayerC=\"2\"\n");
+		assert(readFile(files[2]) == "layerC=\"3\"\nlayerD=\"4\"\n");
+		assert(config.origins.at("layerD") == 2);
+
+		for (const auto& file : files) remove(file.c_str());
+	}
+
+	void configWatcherTest()
+	{
+		static constexpr auto filename = "configWatcherTest.ini";
+		{
+			std::ofstream(filename) << "watchedA=\"1\"\nwatchedB=\"2\"\n";
+		}
+		size_t callbacksA = 0;
+		size_t callbacksB = 0;
+		ccli::Var<int> varA(""sv, "watchedA"sv, 0, ccli::ConfigRdwr, ""sv, [&](int) { callbacksA++; });
+		ccli::Var<int, 1, ccli::MaxLimit<10>> varB(""sv, "watchedB"sv, 0, ccli::ConfigRdwr, ""sv, [&](int) { callbacksB++; });
+		ccli::ConfigWatcher watcher{ filename, ccli::loadConfig(filename) };
+		callbacksA = callbacksB = 0;
+		assert(watcher.poll() == 0);
+
+		// only the changed value is applied
+		{
+			std::ofstream(filename) << "# edited\nwatchedA=\"1\"\nwatchedB=\"20\"\n";
+		}
+		assert(watcher.poll() == 1);
+		assert(varA.value() == 1 && varB.value() == 10);
+		assert(callbacksA == 0 && callbacksB == 1);
+		assert(watcher.poll() == 0);
+
+		// own writes through the watcher cache are not applied again
+		varA.value(3);
+		ccli::writeConfig(filename, watcher.cache());
+		assert(watcher.poll() == 0);
+		assert(callbacksA == 1);
+
+		// replaced files are detected as well
+		{
+			std::ofstream("configWatcherTest.ini.new") << "watchedA=\"4\"\nwatchedB=\"10\"\n";
+		}
+		std::filesystem::rename("configWatcherTest.ini.new", filename);
+		assert(watcher.poll() == 1);
+		assert(varA.value() == 4);
+		remove(filename);
+		assert(watcher.poll() == 0);
+	}
+
+	void configParsingTest()
+	{
+		ccli::Var<std::string, 2> quotedVar(""sv, "quoted"sv, { "", "" }, ccli::ConfigRead);
+		ccli::Var<int> plainVar(""sv, "plain"sv, 0, ccli::ConfigRead);
+		ccli::Var<std::string> mixedVar(""sv, "mixed"sv, "", ccli::ConfigRead);
+		ccli::Var<int> noConfigVar(""sv, "noConfig"sv, 0);
+
+		static constexpr auto filename = "configParsingTest.ini";
+		{
+			std::ofstream cfgfile(filename);
+			cfgfile << "# comment\nquoted='a b,c'\nplain=42\n\nmixed=\"it's\"\nnoConfig=\"1\"\nunknown=\"x\"";
+		}
+
+		ccli::applyConfig(filename);
+		assert(quotedVar[0] == "a b" && quotedVar[1] == "c");
+		assert(plainVar == 42);
+		assert(mixedVar.value() == "its");
+		assert(noConfigVar == 0);
+
+		const ccli::ConfigCache cache = ccli::loadConfig(filename);
+		assert(cache.size() == 5);
+		assert(cache.at("quoted") == "a b,c" && cache.at("mixed") == "its" && cache.at("unknown") == "x");
+
+		// a missing file is not an error
+		assert(ccli::loadConfig("doesNotExist.ini").empty());
+		if (remove(filename) != 0)
+		{
+			std::cout << "Error deleting file" << '\n';
+		}
+	}
+
 	void registeredVarTest()
 	{
 		ccli::Var<float, 4, ccli::MaxLimit<1>, ccli::MinLimit<-1>> float4Var("f1", "float1", { 0 }, ccli::None, "First bool Var");
@@ -381,6 +1037,271 @@ namespace
 		std::cout << *stringVar.asString() << '\n';
 	}
 
+	void responseFileTest() {
+		{
+			std::ofstream("responseFileTest.txt") << "--respInt 5\n-rs \"two words\" --respArray 1 2\r\n\t@responseFileNested.txt '--respEscaped=a\\b'";
+			std::ofstream("responseFileNested.txt") << "3 --respFlag --respString=\"quoted \\\"value\\\"\"";
+		}
+		ccli::Var<int> intVar(""sv, "respInt"sv, 0);
+		ccli::Var<std::string> shortVar("rs"sv, ""sv, "");
+		ccli::Var<int, 3> arrayVar(""sv, "respArray"sv, { 0, 0, 0 });
+		ccli::Var<bool> flagVar(""sv, "respFlag"sv, false);
+		ccli::Var<std::string> stringVar(""sv, "respString"sv, "");
+		ccli::Var<std::string> escapedVar(""sv, "respEscaped"sv, "");
+
+		// response files are expanded in place, also nested ones
+		const char* argv[] = { "@responseFileTest.txt", "--respInt", "6" };
+		ccli::parseArgs(std::size(argv), argv);
+		assert(intVar.value() == 6);
+		assert(shortVar.value() == "two words");
+		assert(arrayVar[0] == 1 && arrayVar[1] == 2 && arrayVar[2] == 3);
+		assert(flagVar.value());
+		assert(stringVar.value() == "quoted \"value\"");
+		assert(escapedVar.value() == "a\\b");
+
+		// missing and recursive response files are reported after all arguments were applied
+		{
+			std::ofstream("responseFileRecursive.txt") << "--respInt 7 @responseFileRecursive.txt";
+		}
+		bool didCatch = false;
+		try {
+			const char* recursive[] = { "@responseFileRecursive.txt" };
+			ccli::parseArgs(std::size(recursive), recursive);
+		}
+		catch (const ccli::FileError& e) {
+			didCatch = true;
+			assert(e.filePath() == "responseFileRecursive.txt"sv);
+		}
+		assert(didCatch && intVar.value() == 7);
+
+		didCatch = false;
+		try {
+			const char* missing[] = { "@responseFileMissing.txt", "--respInt=8" };
+			ccli::parseArgs(std::size(missing), missing);
+		}
+		catch (const ccli::FileError& e) {
+			didCatch = true;
+			assert(e.kind() == ccli::FileError::Kind::ResponseFile);
+			assert(e.message() == "Could not read response file 'responseFileMissing.txt'. It does not exist or is nested too deeply.");
+		}
+		assert(didCatch && intVar.value() == 8);
+
+		// values of options are never expanded, '@@' passes a literal '@' anywhere else
+		ccli::Var<std::string, 2> pairVar(""sv, "respPair"sv, { "", "" });
+		const char* literal[] = { "--respString", "@home", "--respPair", "@a", "@@b" };
+		ccli::parseArgs(std::size(literal), literal);
+		assert(stringVar.value() == "@home");
+		assert(pairVar[0] == "@a" && pairVar[1] == "@b");
+		std::ofstream("responseFileSwitch.txt") << "--respString switched";
+		const char* afterSwitch[] = { "--respFlag", "@responseFileSwitch.txt" };
+		ccli::parseArgs(std::size(afterSwitch), afterSwitch);
+		assert(stringVar.value() == "switched");
+
+		// console input does not read files
+		ccli::parseLine("--respString @responseFileNested.txt --respInt 9");
+		assert(stringVar.value() == "@responseFileNested.txt" && intVar.value() == 9);
+
+		// unknown vars with an inline value are reported as well
+		didCatch = false;
+		try {
+			const char* unknown[] = { "--respUnknown=1" };
+			ccli::parseArgs(std::size(unknown), unknown);
+		}
+		catch (const ccli::UnknownArgError&) {
+			didCatch = true;
+		}
+		assert(didCatch);
+
+		remove("responseFileTest.txt");
+		remove("responseFileNested.txt");
+		remove("responseFileRecursive.txt");
+		remove("responseFileSwitch.txt");
+	}
+
+	void parseContextTest() {
+		ccli::ParseContext context;
+		{
+			ccli::Var<int> intVar("ci"sv, "contextInt"sv, 0);
+			ccli::Var<bool> boolVar(""sv, "contextBool"sv, false);
+
+			// no program name by default, the context can be reused
+			const char* argv[] = { "--contextInt", "1", "--contextBool" };
+			assert(context.parse(std::size(argv), argv));
+			assert(intVar.value() == 1 && boolVar.value());
+			const std::string_view line[] = { "-ci", "2" };
+			assert(context.parse(line));
+			assert(intVar.value() == 2);
+
+			ccli::ParseContext skipContext{ ccli::ParseContext::ProgramName::Skip };
+			const char* skipArgv[] = { "--contextInt", "--contextInt", "3" };
+			assert(skipContext.parse(std::size(skipArgv), skipArgv));
+			assert(intVar.value() == 3);
+
+			// all errors are collected, the valid arguments are still applied
+			const std::string_view bad[] = { "--contextUnknown", "--contextInt", "x", "--contextBool", "--contextInt" };
+			assert(!context.parse(bad));
+			const auto errors = context.errors();
+			assert(errors.size() == 3);
+			assert(errors[0].kind == ccli::ParseContext::Error::Kind::UnknownArg && errors[0].argument == "--contextUnknown");
+			assert(errors[1].kind == ccli::ParseContext::Error::Kind::Conversion && errors[1].option == "--contextInt" && errors[1].argument == "x");
+			assert(errors[2].kind == ccli::ParseContext::Error::Kind::MissingValue && errors[2].argument == "--contextInt");
+			bool didCatch = false;
+			try {
+				context.throwFirstError();
+			}
+			catch (const ccli::UnknownArgError& e) {
+				didCatch = true;
+				assert(e.unknownName() == "--contextUnknown"sv);
+			}
+			assert(didCatch);
+			assert(context.parse(line) && context.errors().empty());
+		}
+
+		// cached vars are dropped once vars are destroyed
+		ccli::Var<int> intVar(""sv, "contextInt"sv, 0);
+		const std::string_view line[] = { "--contextInt", "4" };
+		assert(context.parse(line));
+		assert(intVar.value() == 4);
+
+		// a callback destroying a cached var during the parse turns later uses into unknown arguments
+		auto victimVar = std::make_unique<ccli::Var<int>>(""sv, "contextVictim"sv, 0);
+		ccli::Var<int> killerVar(""sv, "contextKiller"sv, 0, ccli::None, ""sv, [&](int) { victimVar.reset(); });
+		const std::string_view warmup[] = { "--contextVictim", "1" };
+		assert(context.parse(warmup));
+		const std::string_view kill[] = { "--contextKiller", "1", "--contextVictim", "2" };
+		assert(!context.parse(kill));
+		assert(!victimVar && context.errors().size() == 1);
+		assert(context.errors()[0].kind == ccli::ParseContext::Error::Kind::UnknownArg);
+		assert(context.errors()[0].argument == "--contextVictim");
+
+		// a deferred conversion error does not keep its var, it is looked up again when thrown
+		victimVar = std::make_unique<ccli::Var<int>>(""sv, "contextVictim"sv, 0);
+		const std::string_view convert[] = { "--contextVictim", "x", "--contextKiller", "1" };
+		assert(!context.parse(convert));
+		assert(!victimVar && context.errors().size() == 1);
+		bool didCatch = false;
+		try {
+			context.throwFirstError();
+		}
+		catch (const ccli::UnknownArgError& e) {
+			didCatch = true;
+			assert(e.unknownName() == "--contextVictim"sv);
+		}
+		assert(didCatch);
+	}
+
+	void parseLineTest() {
+		ccli::Var<std::string> nameVar("ln"sv, "lineName"sv, "");
+		ccli::Var<int, 2> sizeVar(""sv, "lineSize"sv, { 0, 0 });
+		ccli::Var<bool> flagVar(""sv, "lineFlag"sv, false);
+
+		ccli::parseLine(R"(  -ln "quoted name"	--lineSize 1 2 --lineFlag)"sv);
+		assert(nameVar.value() == "quoted name");
+		assert(sizeVar[0] == 1 && sizeVar[1] == 2 && flagVar.value());
+		ccli::parseLine(R"(--lineName=it\'s\ escaped)"sv);
+		assert(nameVar.value() == "it's escaped");
+		ccli::parseLine(R"(--lineName='single \quotes')"sv);
+		assert(nameVar.value() == "single \\quotes");
+
+		// lines are independent commands
+		ccli::parseLines("# comment\n--lineSize 3\r\n\n4\n--lineName \"last line\""sv);
+		assert(sizeVar[0] == 3 && sizeVar[1] == 2);
+		assert(nameVar.value() == "last line");
+
+		ccli::ParseContext context;
+		assert(!context.parseLines("--lineFlag\n--lineSize\n--lineUnknown 1"sv));
+		const auto errors = context.errors();
+		assert(errors.size() == 2);
+		assert(errors[0].kind == ccli::ParseContext::Error::Kind::MissingValue && errors[0].line == 2);
+		assert(errors[1].kind == ccli::ParseContext::Error::Kind::UnknownArg && errors[1].line == 3);
+
+		bool didCatch = false;
+		try {
+			ccli::parseLine("--lineSize"sv);
+		}
+		catch (const ccli::MissingValueError&) {
+			didCatch = true;
+		}
+		assert(didCatch);
+	}
+
+	void setEnv(const char* name, const char* value)
+	{
+#ifdef _WIN32
+		_putenv_s(name, value);
+#else
+		setenv(name, value, 1);
+#endif
+	}
+
+	void unsetEnv(const char* name)
+	{
+#ifdef _WIN32
+		_putenv_s(name, "");
+#else
+		unsetenv(name);
+#endif
+	}
+
+	void parseEnvTest() {
+		ccli::Var<int> fooBarVar(""sv, "fooBar"sv, 0);
+		ccli::Var<std::string> snakeVar(""sv, "snake_case"sv, "");
+		ccli::Var<float, 2> arrayVar(""sv, "env-array"sv, { 0.0f, 0.0f });
+		ccli::Var<bool> flagVar(""sv, "envFlag"sv, false);
+		ccli::Var<int> readOnlyVar(""sv, "envReadOnly"sv, 1, ccli::ReadOnly);
+		setEnv("CCLITEST_FOO_BAR", "12");
+		setEnv("CCLITEST_SNAKE_CASE", "some value");
+		setEnv("CCLITEST_ENV_ARRAY", "1.5,2.5");
+		setEnv("CCLITEST_ENVFLAG", "");
+		setEnv("CCLITEST_ENV_READ_ONLY", "2");
+		setEnv("OTHER_FOO_BAR", "13");
+
+		ccli::parseEnv("CCLITEST_"sv);
+		assert(fooBarVar.value() == 12);
+		assert(snakeVar.value() == "some value");
+		assert(arrayVar[0] == 1.5f && arrayVar[1] == 2.5f);
+		assert(flagVar.value());
+		assert(readOnlyVar.value() == 1);
+
+		// errors are thrown after all values were applied
+		setEnv("CCLITEST_FOO_BAR", "notANumber");
+		setEnv("CCLITEST_UNKNOWN", "1");
+		setEnv("CCLITEST_SNAKE_CASE", "other value");
+		bool didCatch = false;
+		try {
+			ccli::parseEnv("CCLITEST_"sv);
+		}
+		catch (const ccli::UnknownArgError& e) {
+			didCatch = true;
+			assert(e.unknownName() == "CCLITEST_UNKNOWN"sv);
+		}
+		assert(didCatch && snakeVar.value() == "other value");
+
+		// names which normalize to the same string are reported instead of picking one of the vars
+		unsetEnv("CCLITEST_UNKNOWN");
+		setEnv("CCLITEST_FOO_BAR", "14");
+		{
+			ccli::Var<int> collisionVar(""sv, "foo_bar"sv, 0);
+			didCatch = false;
+			try {
+				ccli::parseEnv("CCLITEST_"sv);
+			}
+			catch (const ccli::AmbiguousArgError& e) {
+				didCatch = true;
+				assert(e.ambiguousName() == "CCLITEST_FOO_BAR"sv);
+			}
+			assert(didCatch && fooBarVar.value() == 12 && collisionVar.value() == 0);
+		}
+		ccli::parseEnv("CCLITEST_"sv);
+		assert(fooBarVar.value() == 14);
+
+		for (const char* name : { "CCLITEST_FOO_BAR", "CCLITEST_SNAKE_CASE", "CCLITEST_ENV_ARRAY", "CCLITEST_ENVFLAG",
+			"CCLITEST_ENV_READ_ONLY", "OTHER_FOO_BAR" })
+		{
+			unsetEnv(name);
+		}
+	}
+
 	void deductionTest() {
 		ccli::Var myVar{ "myVar"sv, ""sv, 1.0f };
 		static_assert(std::is_same_v<decltype(myVar), ccli::Var<float>>, "Could not deduce ccli::Var<float>");
@@ -447,6 +1368,207 @@ namespace
 		assert(std::abs(myVar2[2] - 3.0f) < std::numeric_limits<float>::epsilon());
 	}
 
+	void valueStringTest() {
+		ccli::Var<float, 3> floatVar{ "floatStr"sv, ""sv, { 1.5f, 0.1f, -2.0f } };
+		ccli::Var<bool, 2> boolVar{ "boolStr"sv, ""sv, { true, false } };
+		ccli::Var<int8_t> charVar{ "charStr"sv, ""sv, -5 };
+		ccli::Var<std::string, 2> stringVar{ "stringStr"sv, ""sv, { "a", "bc" } };
+
+		assert(floatVar.valueString() == "1.5,0.1,-2");
+		assert(boolVar.valueString() == "true,false");
+		assert(charVar.valueString() == "-5");
+		assert(stringVar.valueString() == "a,bc");
+
+		// formatting round-trips
+		const std::string floatString = floatVar.valueString();
+		floatVar.valueString(floatString);
+		assert(floatVar[1] == 0.1f);
+
+		// too small buffers are filled as far as possible
+		std::array<char, 4> buffer{};
+		assert(floatVar.formatValue(buffer) == floatString.size());
+		assert(std::string_view(buffer.data(), buffer.size()) == "1.5,"sv);
+
+		ccli::Var<std::string> longVar{ "longStr"sv, ""sv, std::string(1000, 'x') };
+		assert(longVar.valueString() == std::string(1000, 'x'));
+	}
+
+	void bulkArrayParsingTest() {
+		constexpr size_t size = 1024;
+		ccli::Var<float, size, ccli::MaxLimit<1000>> floatVar{ "bulkFloat"sv, ""sv, { 0.0f }, ccli::None, ""sv,
+			[](std::span<const float>) {} };
+		ccli::Var<std::string, 3> stringVar{ "bulkString"sv, ""sv, { "x", "y", "z" } };
+
+		std::string csv;
+		for (size_t i = 0; i < size + 10; i++) csv += std::to_string(i) + ".5,";
+		csv.pop_back();
+
+		// elements beyond the size are ignored, limits are applied to every element
+		floatVar.valueString(csv);
+		assert(floatVar[0] == 0.5f && floatVar[999] == 999.5f && floatVar[1000] == 1000.0f && floatVar[size - 1] == 1000.0f);
+
+		// the whole array is left untouched behind the last token
+		floatVar.valueString("7,8"sv);
+		assert(floatVar[0] == 7.0f && floatVar[1] == 8.0f && floatVar[2] == 2.5f);
+
+		// empty tokens are kept as empty strings
+		stringVar.valueString(",b,"sv);
+		assert(stringVar[0].empty() && stringVar[1] == "b" && stringVar[2].empty());
+		stringVar.valueString("only"sv);
+		assert(stringVar[0] == "only" && stringVar[1] == "b");
+
+		// a bad element throws, the elements before it are already set
+		bool threw = false;
+		try { floatVar.valueString("3,nope,5"sv); }
+		catch (const ccli::ConversionError&) { threw = true; }
+		assert(threw && floatVar[0] == 3.0f && floatVar[2] == 2.5f);
+
+		// chained limits are applied in place, starting with the initial value
+		ccli::Var<int, 4, ccli::MinLimit<-2>, ccli::MaxLimit<2>, ccli::Atomic> clampVar{ "bulkClamp"sv, ""sv, { -5, 5, 1, 0 } };
+		assert(clampVar[0] == -2 && clampVar[1] == 2 && clampVar[2] == 1);
+		clampVar.valueString("3,-3,-1,9"sv);
+		assert(clampVar[0] == 2 && clampVar[1] == -2 && clampVar[2] == -1 && clampVar[3] == 2);
+	}
+
+	void dynamicVarTest() {
+		static constexpr auto filename = "dynamicVarTest.ini";
+		static constexpr auto binaryFilename = "dynamicVarTest.ini.bin";
+		size_t callbackSize = 0;
+		ccli::Var<int, ccli::Dynamic> intVar{ "dynInt"sv, ""sv, { 1, 2 }, ccli::None, ""sv,
+			[&](std::span<const int> values) { callbackSize = values.size(); } };
+		ccli::Var<std::string, ccli::Dynamic> hostVar{ ""sv, "dynHosts"sv, {}, ccli::ConfigRdwr };
+		ccli::Var<float, ccli::Dynamic, ccli::MaxLimit<10>> floatVar{ ""sv, "dynFloats"sv, {}, ccli::ConfigRead };
+
+		ccli::Var<int, 2> fixedVar{ "dynFixed"sv, ""sv };
+		assert(intVar.isDynamic() && !fixedVar.isDynamic());
+		assert(intVar.size() == 2 && hostVar.size() == 0 && hostVar.valueString().empty());
+
+		// the size follows the input, empty input clears the list
+		intVar.valueString("5,6,7"sv);
+		assert(intVar.size() == 3 && intVar[2] == 7 && callbackSize == 3);
+		assert(intVar.valueString() == "5,6,7");
+		intVar.valueString("8"sv);
+		assert(intVar.value().size() == 1 && intVar.asInt(0) == 8);
+		intVar.valueString(""sv);
+		assert(intVar.size() == 0 && callbackSize == 0);
+
+		// storing right behind the last element appends it
+		assert(intVar.tryStore(3LL, 0) && intVar.tryStore(4LL, 1) && intVar.size() == 2);
+		bool threw = false;
+		try { intVar.tryStore(5LL, 3); }
+		catch (const std::out_of_range&) { threw = true; }
+		assert(threw && intVar.size() == 2);
+
+		// long lists move from the inline buffer to the pool
+		std::string csv;
+		for (size_t i = 0; i < 100; i++) csv += std::to_string(i) + ",";
+		csv.pop_back();
+		floatVar.valueString(csv);
+		assert(floatVar.size() == 100 && floatVar[5] == 5.0f && floatVar[99] == 10.0f);
+
+		// values of one option continue over several arguments
+		const std::string_view args[] = { "--dynHosts", "a,b", "c", "-dynInt", "1" };
+		ccli::ParseContext context;
+		assert(context.parse(args));
+		assert(hostVar.size() == 3 && hostVar[1] == "b" && hostVar[2] == "c" && intVar.size() == 1);
+
+		// the binary config cache restores the length
+		{
+			std::ofstream cfgfile(filename);
+			cfgfile << "dynHosts=\"x,y,z,w\"\ndynFloats=\"1,2\"\n";
+		}
+		remove(binaryFilename);
+		ccli::applyConfigCached(filename);
+		assert(hostVar.size() == 4 && floatVar.size() == 2);
+		hostVar.valueString("q"sv);
+		floatVar.valueString(""sv);
+		ccli::applyConfigCached(filename);
+		assert(hostVar.size() == 4 && hostVar[3] == "w" && floatVar.size() == 2 && floatVar[1] == 2.0f);
+		remove(filename);
+		remove(binaryFilename);
+	}
+
+	void numberParsingTest() {
+		ccli::Var<uint8_t> uint8Var{ "u8"sv, ""sv, 0 };
+		ccli::Var<int16_t, 3> int16Var{ "i16"sv, ""sv, { 0, 0, 0 } };
+		ccli::Var<uint64_t> uint64Var{ "u64"sv, ""sv, 0 };
+		ccli::Var<double, 2> doubleVar{ "d"sv, ""sv, { 0.0, 0.0 } };
+
+		uint8Var.valueString("0xff"sv);
+		assert(uint8Var == 255);
+		uint8Var.valueString("0b101"sv);
+		assert(uint8Var == 5);
+		int16Var.valueString("-32768, +0x10,-0b11"sv);
+		assert(int16Var[0] == -32768 && int16Var[1] == 16 && int16Var[2] == -3);
+		uint64Var.valueString("18446744073709551615"sv);
+		assert(uint64Var == std::numeric_limits<uint64_t>::max());
+		doubleVar.valueString("-1.5e3,0x1p4"sv);
+		assert(doubleVar[0] == -1500.0 && doubleVar[1] == 16.0);
+
+		// values which do not fit into the type are rejected
+		auto rejects = [](ccli::VarBase& var, const std::string_view value) {
+			try {
+				var.valueString(value);
+			}
+			catch (const ccli::ConversionError& e) {
+				assert(e.unconvertibleValueString() == value);
+				return true;
+			}
+			return false;
+		};
+		assert(rejects(uint8Var, "256"sv));
+		assert(rejects(uint8Var, "-1"sv));
+		assert(rejects(uint8Var, "0x"sv));
+		assert(rejects(uint8Var, "--1"sv));
+		assert(rejects(int16Var, "32768"sv));
+		assert(rejects(uint64Var, "18446744073709551616"sv));
+		assert(rejects(doubleVar, "1.0.0"sv));
+		assert(rejects(doubleVar, "0b1"sv));
+		assert(uint8Var == 5);
+	}
+
+	void boolParsingTest() {
+		ccli::Var<bool, 8> boolVar{ "bools"sv, ""sv };
+		boolVar.valueString("TRUE,yes,On,1,False,NO,off,0"sv);
+		for (size_t i = 0; i < 4; i++) assert(boolVar[i] == true);
+		for (size_t i = 4; i < 8; i++) assert(boolVar[i] == false);
+
+		bool didCatch = false;
+		try {
+			boolVar.valueString("maybe"sv);
+		}
+		catch (const ccli::ConversionError& e) {
+			didCatch = true;
+			assert(e.unconvertibleValueString() == "maybe"sv);
+		}
+		assert(didCatch);
+
+		didCatch = false;
+		try {
+			boolVar.valueString("\x11"sv);
+		}
+		catch (const ccli::ConversionError&) {
+			didCatch = true;
+		}
+		assert(didCatch);
+
+		// whitespace around a word is ignored, a value made only of whitespace is not a missing value
+		boolVar.valueString(" off ,\ton\t,0 ,1,no,yes,false,true"sv);
+		assert(!boolVar[0] && boolVar[1] && !boolVar[2] && boolVar[3]);
+		didCatch = false;
+		try {
+			boolVar.valueString("1, \t,0"sv);
+		}
+		catch (const ccli::ConversionError& e) {
+			didCatch = true;
+			assert(e.unconvertibleValueString() == " \t"sv);
+		}
+		assert(didCatch);
+		ccli::Var<int> intVar{ ""sv, "boolParsingInt"sv };
+		intVar.valueString(" 7\t"sv);
+		assert(intVar.value() == 7);
+	}
+
 	void tryStoreTest() {
 		ccli::Var<float> myVar1{ "float1"sv, ""sv, 1.0f };
 		ccli::Var<std::string> myVar2{ "string1"sv, ""sv, "someValue" };
@@ -473,6 +1595,137 @@ namespace
 		}
 	}
 
+	void manyVarsTest()
+	{
+		constexpr size_t count = 1000;
+		std::vector<std::string> names;
+		std::vector<std::unique_ptr<ccli::Var<int>>> vars;
+		for (size_t i = 0; i < count; i++) names.push_back("manyVar" + std::to_string(i));
+		for (size_t i = 0; i < count; i++) vars.push_back(std::make_unique<ccli::Var<int>>(""sv, names[i], 0));
+
+		// remove every second var, lookups of the remaining ones have to keep working
+		for (size_t i = 0; i < count; i += 2) vars[i].reset();
+		for (size_t i = 1; i < count; i += 2)
+		{
+			const std::string arg = "--" + names[i] + "=" + std::to_string(i);
+			const char* argv[] = { arg.c_str() };
+			ccli::parseArgs(std::size(argv), argv);
+			assert(vars[i]->value() == static_cast<int>(i));
+		}
+
+		bool didCatch = false;
+		try {
+			const char* argv[] = { "--manyVar0", "1" };
+			ccli::parseArgs(std::size(argv), argv);
+		}
+		catch (const ccli::UnknownArgError&) {
+			didCatch = true;
+		}
+		assert(didCatch);
+
+		// names of removed vars can be registered again
+		ccli::Var<int> reused(""sv, names[0], 0);
+		didCatch = false;
+		try {
+			ccli::Var<int> duplicate(""sv, names[1], 0);
+		}
+		catch (const ccli::DuplicatedVarNameError& e) {
+			didCatch = true;
+			assert(e.duplicatedName() == names[1]);
+		}
+		assert(didCatch);
+	}
+
+	void unregisterTest()
+	{
+		ccli::Var<int> a("ua"sv, "unregA"sv, 1);
+		ccli::Var<int> b("ub"sv, "unregB"sv, 2);
+		auto c = std::make_unique<ccli::Var<int>>("uc"sv, "unregC"sv, 3);
+
+		ccli::VarBase* toRemove[] = { &a, c.get() };
+		ccli::unregisterVars(toRemove);
+		assert(!a.isRegistered() && b.isRegistered() && !c->isRegistered());
+		c.reset();
+
+		// the name of an unregistered var is free again
+		ccli::Var<int> a2("ua"sv, "unregA"sv, 4);
+		const char* argv[] = { "--unregA", "5" };
+		ccli::parseArgs(std::size(argv), argv);
+		assert(a2.value() == 5 && a.value() == 1);
+
+		// vars can be destroyed while iterating, indices stay dense
+		auto d = std::make_unique<ccli::Var<int>>("ud"sv, "unregD"sv, 5);
+		std::vector<size_t> indices;
+		ccli::forEachVar([&](ccli::VarBase& var, const size_t idx) -> ccli::IterationDecision {
+			if (&var == &b) d.reset();
+			indices.push_back(idx);
+			return {};
+		});
+		for (size_t i = 0; i < indices.size(); i++) assert(indices[i] == i);
+		assert(indices.size() == 2);
+	}
+
+	void concurrentRegistryTest()
+	{
+		// vars are created and destroyed on some threads while another one iterates them, parses arguments, runs
+		// callbacks and writes and loads the config
+		constexpr size_t threadCount = 4;
+		constexpr size_t rounds = 100;
+		constexpr size_t varCount = 50;
+		const std::string cfgFile = "concurrentRegistry.cfg";
+		ccli::Var<int> stableVar{ ""sv, "registryStable"sv, 0, ccli::ConfigRdwr };
+		std::atomic<size_t> running{ threadCount };
+		std::atomic<size_t> callbacks{ 0 };
+		std::vector<std::thread> threads;
+		for (size_t t = 0; t < threadCount; t++)
+		{
+			threads.emplace_back([&, t] {
+				std::vector<std::string> names;
+				for (size_t i = 0; i < varCount; i++) names.push_back("thread" + std::to_string(t) + "Var" + std::to_string(i));
+				for (size_t round = 0; round < rounds; round++)
+				{
+					std::vector<std::unique_ptr<ccli::Var<std::string>>> vars;
+					for (const auto& name : names)
+					{
+						vars.push_back(std::make_unique<ccli::Var<std::string>>(""sv, name, "initial value"s,
+							ccli::ConfigRdwr, ""sv, [&callbacks](const std::string&) { callbacks++; }));
+					}
+					for (size_t i = 0; i < varCount; i += 2) vars[i].reset();
+				}
+				running--;
+			});
+		}
+
+		ccli::ConfigCache cache;
+		int iteration = 0;
+		do
+		{
+			ccli::forEachVar([&](ccli::VarBase& var, size_t) -> ccli::IterationDecision {
+				if (!var.longName().starts_with("thread")) return {};
+				assert(var.valueString() == "initial value");
+				var.chargeCallback();
+				return {};
+			});
+			const std::string arg = "--registryStable=" + std::to_string(++iteration);
+			const char* argv[] = { arg.c_str() };
+			ccli::parseArgs(std::size(argv), argv);
+			assert(stableVar.value() == iteration);
+			ccli::writeConfig(cfgFile, cache);
+			ccli::loadConfig(cfgFile);
+			assert(stableVar.value() == iteration);
+			ccli::executeCallbacks();
+		} while (running.load());
+		for (auto& thread : threads) thread.join();
+
+		size_t count = 0;
+		ccli::forEachVar([&](ccli::VarBase& var, size_t) -> ccli::IterationDecision {
+			count += var.longName().starts_with("thread");
+			return {};
+		});
+		assert(count == 0);
+		std::filesystem::remove(cfgFile);
+	}
+
 	void unregisteredVarWarning()
 	{
 		try {
@@ -494,14 +1747,38 @@ int main(int argc, char* argv[]) {
 	immutableTest();
 	arrayTest();
 	lambdaCallbackTest();
+	callbackQueueTest();
+	contextCallbackTest();
+	atomicVarTest();
 	exceptionTest();
 	configTest();
 	configTest2();
+	configParsingTest();
+	configDirtyTest();
+	configRewriteTest();
+	configAsyncTest();
+	configBinaryCacheTest();
+	pendingConfigTest();
+	configLayersTest();
+	configWatcherTest();
 	registeredVarTest();
 	deductionTest();
+	responseFileTest();
+	parseContextTest();
+	parseLineTest();
+	parseEnvTest();
 	multiValueParsing();
 	settingVariableTest();
+	valueStringTest();
+	bulkArrayParsingTest();
+	dynamicVarTest();
+	numberParsingTest();
+	boolParsingTest();
 	tryStoreTest();
+	manyVarsTest();
+	memoryStatsTest();
+	unregisterTest();
+	concurrentRegistryTest();
 	unregisteredVarWarning();
 
 	return 0;
@@ -0,0 +1,422 @@
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <chrono>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <array>
+#include <memory>
+#include <filesystem>
+#include <cstdlib>
+#include <new>
+#include <thread>
+#include <algorithm>
+#include <cctype>
+#include <atomic>
+#include <ccli/ccli.h>
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+using namespace std::literals;
+
+// count all heap allocations to report allocations per op
+namespace
+{
+	// incremented by every thread of the concurrent benchmarks
+	std::atomic<size_t> allocationCount{ 0 };
+}
+
+void* operator new(const size_t size)
+{
+	allocationCount.fetch_add(1, std::memory_order_relaxed);
+	if (void* ptr = std::malloc(size ? size : 1)) return ptr;
+	throw std::bad_alloc{};
+}
+
+void operator delete(void* ptr) noexcept
+{
+	std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept
+{
+	std::free(ptr);
+}
+
+// new of over-aligned types goes through these overloads instead
+void* operator new(const size_t size, const std::align_val_t alignment)
+{
+	allocationCount.fetch_add(1, std::memory_order_relaxed);
+	const size_t align = static_cast<size_t>(alignment);
+#ifdef _WIN32
+	if (void* ptr = _aligned_malloc(size ? size : 1, align)) return ptr;
+#else
+	// aligned_alloc requires the size to be a multiple of the alignment
+	if (void* ptr = std::aligned_alloc(align, (std::max(size, size_t{ 1 }) + align - 1) / align * align)) return ptr;
+#endif
+	throw std::bad_alloc{};
+}
+
+void operator delete(void* ptr, std::align_val_t) noexcept
+{
+#ifdef _WIN32
+	_aligned_free(ptr);
+#else
+	std::free(ptr);
+#endif
+}
+
+void operator delete(void* ptr, size_t, const std::align_val_t alignment) noexcept
+{
+	operator delete(ptr, alignment);
+}
+
+namespace
+{
+	volatile double sink;
+
+	// returns the time per op in ns
+	template <typename F>
+	double bench(const std::string_view name, const size_t opsPerRun, F&& f)
+	{
+		// warm up, then run until enough time has passed for a stable result
+		f();
+		size_t runs = 0;
+		const size_t allocationsBefore = allocationCount.load(std::memory_order_relaxed);
+		const auto start = std::chrono::steady_clock::now();
+		auto now = start;
+		do
+		{
+			f();
+			runs++;
+			now = std::chrono::steady_clock::now();
+		} while (now - start < 200ms);
+
+		const double ops = static_cast<double>(runs * opsPerRun);
+		const double ns = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(now - start).count());
+		const double allocations = static_cast<double>(allocationCount.load(std::memory_order_relaxed) - allocationsBefore);
+		std::cout << std::left << std::setw(48) << name << std::right << std::fixed
+			<< std::setw(12) << std::setprecision(2) << ns / ops << " ns/op"
+			<< std::setw(10) << std::setprecision(2) << allocations / ops << " allocs/op\n";
+		return ns / ops;
+	}
+
+	std::string makeCSV(const size_t count, const std::string_view element)
+	{
+		std::string csv;
+		for (size_t i = 0; i < count; i++)
+		{
+			if (i) csv += ',';
+			csv += element;
+			csv += std::to_string(i % 10);
+		}
+		return csv;
+	}
+
+	// previous parsing path: strtod on a null terminated copy of each token
+	void strtodReference(const std::string_view csv)
+	{
+		double sum = 0.0;
+		size_t current = 0;
+		std::string token;
+		while (current <= csv.size())
+		{
+			const size_t pos = std::min(csv.find(',', current), csv.size());
+			token = csv.substr(current, pos - current);
+			sum += std::strtod(token.c_str(), nullptr);
+			current = pos + 1;
+		}
+		sink = sum;
+	}
+
+	// previous limit path: every limit took the storage by value and returned a copy, which was assigned back.
+	// Copies of a std::array do not allocate, so this is compared by time only.
+	template <typename TLimit, typename... TRest, typename TArray>
+	TArray copyLimitsReference(TArray x)
+	{
+		for (auto& element : x) element = TLimit::apply(element);
+		if constexpr (sizeof...(TRest) == 0) return x;
+		else return copyLimitsReference<TRest...>(x);
+	}
+
+	void arrayParsing()
+	{
+		constexpr size_t size = 4096;
+		const std::string floatCSV = makeCSV(size, "12345.678"sv);
+		const std::string intCSV = makeCSV(size, "0x1f"sv);
+
+		ccli::Var<float, size> floatVar{ ""sv, "benchFloatArray"sv };
+		ccli::Var<int32_t, size> intVar{ ""sv, "benchIntArray"sv };
+		ccli::Var<bool, size> boolVar{ ""sv, "benchBoolArray"sv };
+		ccli::Var<float, size, ccli::MinLimit<-10000>, ccli::MaxLimit<10000>> limitedVar{ ""sv, "benchLimitedArray"sv };
+		ccli::Var<float, ccli::Dynamic> dynamicVar{ ""sv, "benchDynamicArray"sv };
+		ccli::Var<int32_t, ccli::Dynamic> shortListVar{ ""sv, "benchShortList"sv };
+		std::string boolCSV;
+		for (size_t i = 0; i < size; i++) boolCSV += i % 2 ? "True,"sv : "off,"sv;
+		boolCSV.pop_back();
+
+		bench("parse Var<float, 4096> element (strtod ref)"sv, size, [&] { strtodReference(floatCSV); });
+		bench("parse Var<float, 4096> element"sv, size, [&] { floatVar.valueString(floatCSV); });
+		bench("parse Var<float, 4096> limited element"sv, size, [&] { limitedVar.valueString(floatCSV); });
+		bench("parse Var<float, Dynamic> 4096 element"sv, size, [&] { dynamicVar.valueString(floatCSV); });
+		// fits into the inline buffer
+		bench("parse Var<int32_t, Dynamic> 8 element list"sv, 1, [&] { shortListVar.valueString("1,2,3,4,5,6,7,8"sv); });
+		// a single token still clamps the whole array
+		static std::array<float, size> copyLimitsArray{};
+		bench("clamp Var<float, 4096> limited element (copy ref)"sv, size, [&] {
+			copyLimitsArray[0] = 1.0f;
+			copyLimitsArray = copyLimitsReference<ccli::MinLimit<-10000>, ccli::MaxLimit<10000>>(copyLimitsArray);
+			sink = copyLimitsArray[0];
+		});
+		bench("clamp Var<float, 4096> limited element"sv, size, [&] { limitedVar.valueString("1"sv); });
+		bench("parse Var<int32_t, 4096> hex element"sv, size, [&] { intVar.valueString(intCSV); });
+		bench("parse Var<bool, 4096> element"sv, size, [&] { boolVar.valueString(boolCSV); });
+	}
+
+	// an empty value removes the variable
+	void setEnv(const std::string& name, const std::string& value)
+	{
+#ifdef _WIN32
+		_putenv_s(name.c_str(), value.c_str());
+#else
+		if (value.empty()) unsetenv(name.c_str());
+		else setenv(name.c_str(), value.c_str(), 1);
+#endif
+	}
+
+	/*
+	** synthetic registry with mixed types and array sizes
+	*/
+	struct Registry
+	{
+		std::vector<std::string> names;
+		std::vector<std::unique_ptr<ccli::VarBase>> vars;
+		size_t callbacks{ 0 };
+	};
+
+	void populate(Registry& registry)
+	{
+		const auto flags = ccli::ConfigRdwr;
+		for (size_t i = 0; i < registry.names.size(); i++)
+		{
+			const std::string_view name = registry.names[i];
+			switch (i % 6)
+			{
+			case 0: registry.vars.push_back(std::make_unique<ccli::Var<int>>(""sv, name, static_cast<int>(i), flags)); break;
+			case 1: registry.vars.push_back(std::make_unique<ccli::Var<float, 4>>(""sv, name, ccli::Storage{ 1.0f, 2.0f, 3.0f, 4.0f }, flags)); break;
+			case 2: registry.vars.push_back(std::make_unique<ccli::Var<bool>>(""sv, name, true, flags)); break;
+			case 3: registry.vars.push_back(std::make_unique<ccli::Var<std::string>>(""sv, name, "some value", flags)); break;
+			case 4: registry.vars.push_back(std::make_unique<ccli::Var<double, 16, ccli::MinLimit<0>>>(""sv, name, ccli::Var<double, 16, ccli::MinLimit<0>>::TStorage{}, flags)); break;
+			case 5: registry.vars.push_back(std::make_unique<ccli::Var<uint32_t>>(""sv, name, 7u, flags | ccli::ManualExec, ""sv,
+				[&registry](uint32_t) { registry.callbacks++; })); break;
+			}
+		}
+	}
+
+	Registry makeRegistry(const size_t count)
+	{
+		Registry registry;
+		for (size_t i = 0; i < count; i++) registry.names.push_back("benchVar" + std::to_string(i));
+		populate(registry);
+		return registry;
+	}
+
+	// returns the cost of writing one changed var
+	double registryBenchmarks(const size_t count)
+	{
+		std::cout << "\n-- " << count << " vars\n";
+		const std::string suffix = " ("s + std::to_string(count) + ")";
+		Registry registry = makeRegistry(count);
+
+		const ccli::MemoryStats stats = ccli::memoryStats();
+		const auto perVar = [&](const size_t bytes) { return static_cast<double>(bytes) / static_cast<double>(stats.varCount); };
+		std::cout << std::fixed << std::setprecision(1) << "memory per var: " << perVar(stats.varBytes) << " B object, "
+			<< perVar(stats.nameArenaBytes) << " B names (" << stats.nameCount << " interned), "
+			<< perVar(stats.registryBytes) << " B registry\n";
+
+		bench("Var construction + destruction"s + suffix, count, [&] {
+			registry.vars.clear();
+			populate(registry);
+		});
+
+		// every var once on the command line
+		std::vector<std::string> args;
+		for (const auto& var : registry.vars)
+		{
+			args.push_back("--" + std::string{ var->longName() });
+			if (!var->isBool()) args.push_back(var->valueString());
+		}
+		std::vector<const char*> argv;
+		for (const auto& arg : args) argv.push_back(arg.c_str());
+		bench("parseArgs per var"s + suffix, count, [&] { ccli::parseArgs(argv.size(), argv.data()); });
+		ccli::ParseContext context;
+		bench("ParseContext::parse per var"s + suffix, count, [&] { context.parse(argv.size(), argv.data()); });
+
+		// one console command per var, values are quoted
+		std::string script;
+		for (const auto& arg : args)
+		{
+			if (arg.starts_with("--")) script += "\n" + arg;
+			else script += " \"" + arg + "\"";
+		}
+		bench("ParseContext::parseLines per line"s + suffix, count, [&] { context.parseLines(script); });
+
+		// the same arguments from a response file
+		const std::string responseFile = (std::filesystem::temp_directory_path() / "ccli_bench_args.txt").string();
+		{
+			std::ofstream file(responseFile);
+			for (const auto& arg : args) file << arg << '\n';
+		}
+		const std::string responseArg = "@" + responseFile;
+		const char* responseArgv[] = { responseArg.c_str() };
+		bench("parseArgs @file per var"s + suffix, count, [&] { ccli::parseArgs(1, responseArgv); });
+		std::filesystem::remove(responseFile);
+
+		// every var once in the environment
+		for (const auto& var : registry.vars)
+		{
+			std::string name = "CCLIBENCH_" + std::string{ var->longName() };
+			std::transform(name.begin(), name.end(), name.begin(), [](const char c) { return static_cast<char>(std::toupper(c)); });
+			setEnv(name, var->valueString());
+		}
+		bench("parseEnv per var"s + suffix, count, [&] { ccli::parseEnv("CCLIBENCH_"sv); });
+		for (const auto& var : registry.vars)
+		{
+			std::string name = "CCLIBENCH_" + std::string{ var->longName() };
+			std::transform(name.begin(), name.end(), name.begin(), [](const char c) { return static_cast<char>(std::toupper(c)); });
+			setEnv(name, {});
+		}
+
+		const std::string cfgFile = (std::filesystem::temp_directory_path() / "ccli_bench.ini").string();
+		ccli::writeConfig(cfgFile);
+		bench("loadConfig per var"s + suffix, count, [&] { ccli::loadConfig(cfgFile); });
+		bench("applyConfig per var"s + suffix, count, [&] { ccli::applyConfig(cfgFile); });
+		bench("applyConfigCached per var"s + suffix, count, [&] { ccli::applyConfigCached(cfgFile); });
+		bench("applyConfig before registering per var"s + suffix, count, [&] {
+			registry.vars.clear();
+			ccli::applyConfig(cfgFile);
+			populate(registry);
+		});
+		std::filesystem::remove(cfgFile + ".bin");
+
+		// the same values in three layers, e.g. defaults, site and user config
+		const std::vector<std::string> layers{ cfgFile, cfgFile + ".site", cfgFile + ".user" };
+		std::filesystem::copy_file(cfgFile, layers[1], std::filesystem::copy_options::overwrite_existing);
+		std::filesystem::copy_file(cfgFile, layers[2], std::filesystem::copy_options::overwrite_existing);
+		bench("loadConfig x3 sequential per var"s + suffix, count, [&] {
+			for (const auto& layer : layers) ccli::loadConfig(layer);
+		});
+		bench("loadConfigLayers x3 per var"s + suffix, count, [&] { ccli::loadConfigLayers(layers); });
+		std::filesystem::remove(layers[1]);
+		std::filesystem::remove(layers[2]);
+
+		ccli::ConfigCache cache = ccli::loadConfig(cfgFile);
+		{
+			ccli::ConfigWatcher watcher{ cfgFile, cache };
+			bench("ConfigWatcher idle poll"s + suffix, 1, [&] { sink = static_cast<double>(watcher.poll()); });
+			// only the changed var is applied, the rest is compared against the cache
+			bench("ConfigWatcher reload with one change per var"s + suffix, count, [&] {
+				watcher.cache().begin()->second = "changed";
+				sink = static_cast<double>(watcher.reload());
+			});
+		}
+		bench("writeConfig unchanged per var"s + suffix, count, [&] { ccli::writeConfig(cfgFile, cache); });
+		auto* changedVar = registry.vars.front().get();
+		const double changedWriteCost = bench("writeConfig one changed var"s + suffix, 1, [&] {
+			changedVar->valueString(changedVar->valueString() == "1"sv ? "2"sv : "1"sv);
+			ccli::writeConfig(cfgFile, cache);
+		});
+		bench("writeConfigAsync one changed var (caller)"s + suffix, 1, [&] {
+			changedVar->valueString(changedVar->valueString() == "1"sv ? "2"sv : "1"sv);
+			ccli::writeConfigAsync(cfgFile, cache);
+		});
+		ccli::flushConfig();
+		bench("writeConfig full per var"s + suffix, count, [&] { ccli::writeConfig(cfgFile); });
+		std::filesystem::remove(cfgFile);
+
+		bench("valueString per var"s + suffix, count, [&] {
+			size_t length = 0;
+			for (const auto& var : registry.vars) length += var->valueString().size();
+			sink = static_cast<double>(length);
+		});
+
+		bench("forEachVar per var"s + suffix, count, [&] {
+			size_t sum = 0;
+			ccli::forEachVar([&](ccli::VarBase& var, const size_t idx) -> ccli::IterationDecision {
+				sum += var.size() + idx;
+				return {};
+			});
+			sink = static_cast<double>(sum);
+		});
+
+		bench("executeCallbacks idle per call"s + suffix, 1, [&] { ccli::executeCallbacks(); });
+
+		std::vector<ccli::VarBase*> callbackVars;
+		for (const auto& var : registry.vars) if (var->hasCallback()) callbackVars.push_back(var.get());
+		bench("executeCallbacks per charged var"s + suffix, callbackVars.size(), [&] {
+			for (auto* var : callbackVars) var->chargeCallback();
+			ccli::executeCallbacks();
+		});
+		sink = static_cast<double>(registry.callbacks);
+		return changedWriteCost;
+	}
+
+	// every thread registers its own vars and looks all of them up
+	void concurrentRegistryBenchmark(const size_t threadCount)
+	{
+		constexpr size_t varCount = 10'000;
+		std::vector<std::vector<std::string>> names(threadCount);
+		for (size_t t = 0; t < threadCount; t++)
+		{
+			for (size_t i = 0; i < varCount; i++) names[t].push_back("thread" + std::to_string(t) + "Var" + std::to_string(i));
+		}
+
+		bench("register + 10 lookups + unregister ("s + std::to_string(threadCount) + " threads)", threadCount * varCount, [&] {
+			std::vector<std::thread> threads;
+			for (size_t t = 0; t < threadCount; t++)
+			{
+				threads.emplace_back([&, t] {
+					std::vector<std::unique_ptr<ccli::Var<int>>> vars;
+					for (const auto& name : names[t]) vars.push_back(std::make_unique<ccli::Var<int>>(""sv, name, 0));
+					std::vector<std::string> args;
+					for (size_t i = 0; i < varCount; i++) args.push_back("--" + names[t][i] + "=1");
+					for (size_t r = 0; r < 10; r++)
+					{
+						// a fresh context per round, so every lookup goes to the registry. parseArgs would stat
+						// argv[0] to detect the program name on every call.
+						ccli::ParseContext context;
+						for (const auto& arg : args)
+						{
+							const std::string_view argv[] = { arg };
+							context.parse(argv);
+						}
+					}
+				});
+			}
+			for (auto& thread : threads) thread.join();
+		});
+	}
+}
+
+int main()
+{
+	arrayParsing();
+	std::vector<double> changedWriteCosts;
+	for (const size_t count : { 1'000, 10'000, 100'000 }) changedWriteCosts.push_back(registryBenchmarks(count));
+
+	// one change is written in place or appended, only the fsync varies. Patching a copy of the whole file was
+	// 9x slower at 100k vars than at 1k.
+	const double growth = changedWriteCosts.back() / changedWriteCosts.front();
+	std::cout << "\nwriteConfig one changed var, 100k / 1k vars: " << std::setprecision(2) << growth << "x\n";
+	if (growth > 3.0)
+	{
+		std::cerr << "writeConfig of one change grows with the size of the config file\n";
+		return 1;
+	}
+
+	std::cout << "\n-- concurrent registry\n";
+	for (const size_t threads : { 1, 4, 8 }) concurrentRegistryBenchmark(threads);
+	return 0;
+}